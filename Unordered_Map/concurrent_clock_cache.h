@@ -0,0 +1,299 @@
+#ifndef UNORDERED_MAP__CONCURRENT_CLOCK_CACHE_H_
+#define UNORDERED_MAP__CONCURRENT_CLOCK_CACHE_H_
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <tuple>
+#include <vector>
+
+#include "unordered_map.h"
+
+// A cache sharded like ConcurrentUnorderedMap, with CLOCK eviction per shard:
+// a hit sets the entry's referenced bit, so hits never relink anything and
+// run in parallel. Inserting into a full shard sweeps the hand over a ring of
+// its entries, clearing set bits, and replaces the first entry whose bit was
+// already clear. The capacity is split over the shards as evenly as it goes,
+// with no more shards than entries.
+//
+// Each shard's lock is striped by thread: a reader locks only its own stripe,
+// which also holds its hit and miss counters, so concurrent hits write no
+// shared cache line. Writers lock every stripe of the shard.
+template<typename Key, typename Value, typename Hash = std::hash<Key>,
+    typename Equal = std::equal_to<Key>,
+    typename Alloc = std::allocator<std::pair<const Key, Value>>>
+class ConcurrentClockCache {
+ public:
+  struct Stats {
+    size_t size = 0;
+    size_t capacity = 0;
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t insertions = 0;
+    size_t evictions = 0;
+  };
+
+ private:
+  static const size_t DEFAULT_SHARD_COUNT_ = 16;
+
+  struct Entry;
+  using map_type = UnorderedMap<Key, Entry, Hash, Equal,
+      typename std::allocator_traits<Alloc>::template rebind_alloc<std::pair<const Key, Entry>>>;
+  using node_type = typename map_type::node_type;
+
+  struct Entry {
+    Value value;
+    // Position in the shard's ring.
+    size_t position;
+    mutable std::atomic<bool> referenced{false};
+
+    template<typename V>
+    Entry(V&&, size_t);
+  };
+
+  static const size_t READ_STRIPES_ = 8;
+
+  struct alignas(64) ReadStripe {
+    std::mutex mutex;
+    size_t hits = 0;
+    size_t misses = 0;
+  };
+
+  struct alignas(64) Shard {
+    mutable ReadStripe stripes[READ_STRIPES_];
+    map_type map;
+    std::vector<node_type*> ring;
+    size_t capacity = 0;
+    size_t hand = 0;
+    size_t insertions = 0;
+    size_t evictions = 0;
+  };
+
+  // Holds every stripe of a shard, locked in order.
+  class WriteLock {
+   private:
+    const Shard& shard_;
+
+   public:
+    explicit WriteLock(const Shard&);
+    WriteLock(const WriteLock&) = delete;
+    WriteLock& operator=(const WriteLock&) = delete;
+    ~WriteLock() noexcept;
+  };
+
+  size_t shard_count_;
+  size_t capacity_;
+  std::unique_ptr<Shard[]> shards_;
+  Hash hasher_;
+
+  // Threads take stripes round-robin in the order they first read.
+  static ReadStripe& get_stripe(const Shard&) noexcept;
+  Shard& get_shard(const Key&) const noexcept;
+  template<typename V>
+  void put_value(const Key&, V&&);
+  static void advance(Shard&) noexcept;
+
+ public:
+  explicit ConcurrentClockCache(size_t capacity, size_t shard_count = DEFAULT_SHARD_COUNT_,
+                                const Hash& hasher = Hash(), const Equal& key_equal = Equal(),
+                                const Alloc& alloc = Alloc());
+  ConcurrentClockCache(const ConcurrentClockCache&) = delete;
+  ConcurrentClockCache& operator=(const ConcurrentClockCache&) = delete;
+
+  size_t shard_count() const noexcept;
+  // Exactly the requested capacity, but at least one entry.
+  size_t capacity() const noexcept;
+  size_t size() const;
+  Stats stats() const;
+
+  // Values are returned by copy, as the entry may be evicted right after.
+  std::optional<Value> get(const Key&) const;
+  bool contains(const Key&) const;
+
+  // Inserts or replaces the value, evicting an entry if the shard is full.
+  void put(const Key&, const Value&);
+  void put(const Key&, Value&&);
+  bool erase(const Key&);
+};
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+template<typename V>
+ConcurrentClockCache<Key, Value, Hash, Equal, Alloc>::Entry::Entry(V&& value, size_t position) :
+    value(std::forward<V>(value)), position(position) {}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+ConcurrentClockCache<Key, Value, Hash, Equal, Alloc>::ConcurrentClockCache(
+    size_t capacity, size_t shard_count, const Hash& hasher, const Equal& key_equal, const Alloc& alloc) :
+    shard_count_(std::clamp(shard_count, size_t(1), std::max(capacity, size_t(1)))),
+    capacity_(std::max(capacity, size_t(1))),
+    shards_(new Shard[shard_count_]), hasher_(hasher) {
+  for (size_t i = 0; i < shard_count_; ++i) {
+    shards_[i].capacity = capacity_ / shard_count_ + (i < capacity_ % shard_count_ ? 1 : 0);
+    shards_[i].map = map_type(0, hasher, key_equal, typename map_type::AllocTraits::allocator_type(alloc));
+    shards_[i].map.reserve(shards_[i].capacity + 1);
+    shards_[i].ring.reserve(shards_[i].capacity);
+  }
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+ConcurrentClockCache<Key, Value, Hash, Equal, Alloc>::WriteLock::WriteLock(const Shard& shard) : shard_(shard) {
+  for (auto& stripe : shard_.stripes) {
+    stripe.mutex.lock();
+  }
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+ConcurrentClockCache<Key, Value, Hash, Equal, Alloc>::WriteLock::~WriteLock() noexcept {
+  for (auto& stripe : shard_.stripes) {
+    stripe.mutex.unlock();
+  }
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+typename ConcurrentClockCache<Key, Value, Hash, Equal, Alloc>::ReadStripe&
+ConcurrentClockCache<Key, Value, Hash, Equal, Alloc>::get_stripe(const Shard& shard) noexcept {
+  static std::atomic<size_t> next_stripe{0};
+  thread_local size_t stripe = next_stripe.fetch_add(1, std::memory_order_relaxed) % READ_STRIPES_;
+  return shard.stripes[stripe];
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+typename ConcurrentClockCache<Key, Value, Hash, Equal, Alloc>::Shard&
+ConcurrentClockCache<Key, Value, Hash, Equal, Alloc>::get_shard(const Key& key) const noexcept {
+  return shards_[shard_of(hasher_(key), shard_count_)];
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+void ConcurrentClockCache<Key, Value, Hash, Equal, Alloc>::advance(Shard& shard) noexcept {
+  if (++shard.hand == shard.ring.size()) {
+    shard.hand = 0;
+  }
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+size_t ConcurrentClockCache<Key, Value, Hash, Equal, Alloc>::shard_count() const noexcept {
+  return shard_count_;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+size_t ConcurrentClockCache<Key, Value, Hash, Equal, Alloc>::capacity() const noexcept {
+  return capacity_;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+size_t ConcurrentClockCache<Key, Value, Hash, Equal, Alloc>::size() const {
+  return stats().size;
+}
+
+// Each shard is read under its own lock; the sums are not one atomic snapshot.
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+typename ConcurrentClockCache<Key, Value, Hash, Equal, Alloc>::Stats
+ConcurrentClockCache<Key, Value, Hash, Equal, Alloc>::stats() const {
+  Stats result;
+  result.capacity = capacity();
+  for (size_t i = 0; i < shard_count_; ++i) {
+    WriteLock lock(shards_[i]);
+    result.size += shards_[i].map.size();
+    for (const auto& stripe : shards_[i].stripes) {
+      result.hits += stripe.hits;
+      result.misses += stripe.misses;
+    }
+    result.insertions += shards_[i].insertions;
+    result.evictions += shards_[i].evictions;
+  }
+  return result;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+std::optional<Value> ConcurrentClockCache<Key, Value, Hash, Equal, Alloc>::get(const Key& key) const {
+  Shard& shard = get_shard(key);
+  ReadStripe& stripe = get_stripe(shard);
+  std::lock_guard<std::mutex> lock(stripe.mutex);
+  auto it = shard.map.find(key);
+  if (it == shard.map.end()) {
+    ++stripe.misses;
+    return std::nullopt;
+  }
+  ++stripe.hits;
+  // Hot entries keep their bit set; skipping the store keeps their line shared.
+  if (!it->second.referenced.load(std::memory_order_relaxed)) {
+    it->second.referenced.store(true, std::memory_order_relaxed);
+  }
+  return it->second.value;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+bool ConcurrentClockCache<Key, Value, Hash, Equal, Alloc>::contains(const Key& key) const {
+  Shard& shard = get_shard(key);
+  std::lock_guard<std::mutex> lock(get_stripe(shard).mutex);
+  return shard.map.contains(key);
+}
+
+// The new entry starts unreferenced, so a key seen once goes before any key
+// hit since the hand last passed it.
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+template<typename V>
+void ConcurrentClockCache<Key, Value, Hash, Equal, Alloc>::put_value(const Key& key, V&& value) {
+  Shard& shard = get_shard(key);
+  WriteLock lock(shard);
+  auto it = shard.map.find(key);
+  if (it != shard.map.end()) {
+    it->second.value = std::forward<V>(value);
+    it->second.referenced.store(true, std::memory_order_relaxed);
+    return;
+  }
+  if (shard.ring.size() < shard.capacity) {
+    it = shard.map.emplace(std::piecewise_construct, std::forward_as_tuple(key),
+                           std::forward_as_tuple(std::forward<V>(value), shard.ring.size())).first;
+    // The ring is reserved up to the capacity, so this cannot throw.
+    shard.ring.push_back(&*it);
+    ++shard.insertions;
+    return;
+  }
+  while (shard.ring[shard.hand]->second.referenced.load(std::memory_order_relaxed)) {
+    shard.ring[shard.hand]->second.referenced.store(false, std::memory_order_relaxed);
+    advance(shard);
+  }
+  node_type* victim = shard.ring[shard.hand];
+  it = shard.map.emplace(std::piecewise_construct, std::forward_as_tuple(key),
+                         std::forward_as_tuple(std::forward<V>(value), shard.hand)).first;
+  shard.ring[shard.hand] = &*it;
+  shard.map.erase(victim->first);
+  advance(shard);
+  ++shard.insertions;
+  ++shard.evictions;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+void ConcurrentClockCache<Key, Value, Hash, Equal, Alloc>::put(const Key& key, const Value& value) {
+  put_value(key, value);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+void ConcurrentClockCache<Key, Value, Hash, Equal, Alloc>::put(const Key& key, Value&& value) {
+  put_value(key, std::move(value));
+}
+
+// The last entry of the ring takes the erased entry's place.
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+bool ConcurrentClockCache<Key, Value, Hash, Equal, Alloc>::erase(const Key& key) {
+  Shard& shard = get_shard(key);
+  WriteLock lock(shard);
+  auto it = shard.map.find(key);
+  if (it == shard.map.end()) {
+    return false;
+  }
+  size_t position = it->second.position;
+  shard.ring[position] = shard.ring.back();
+  shard.ring[position]->second.position = position;
+  shard.ring.pop_back();
+  if (shard.hand >= shard.ring.size()) {
+    shard.hand = 0;
+  }
+  shard.map.erase(it);
+  return true;
+}
+
+#endif //UNORDERED_MAP__CONCURRENT_CLOCK_CACHE_H_
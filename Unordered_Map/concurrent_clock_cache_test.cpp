@@ -0,0 +1,158 @@
+#include "concurrent_clock_cache.h"
+
+#include <cassert>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+void TestClock() {
+    // One shard so the hand order is the insertion order.
+    ConcurrentClockCache<int, std::string> cache(3, 1);
+    for (int i = 0; i < 3; ++i) {
+        cache.put(i, std::to_string(i));
+    }
+    assert(cache.size() == 3 && cache.capacity() == 3);
+
+    // 0 gets a second chance, so 1 goes first.
+    assert(*cache.get(0) == "0");
+    cache.put(3, "3");
+    assert(!cache.contains(1) && !cache.get(1).has_value());
+    assert(cache.contains(0) && cache.contains(2) && cache.contains(3));
+
+    // The hand cleared 0's bit on the way, so 2 and then 0 follow.
+    cache.put(4, "4");
+    assert(!cache.contains(2));
+    cache.put(5, "5");
+    assert(!cache.contains(0));
+
+    // Replacing marks the entry as referenced.
+    cache.put(3, "three");
+    cache.put(6, "6");
+    assert(*cache.get(3) == "three" && !cache.contains(4));
+
+    assert(cache.erase(5) && !cache.erase(5));
+    assert(cache.size() == 2);
+    cache.put(7, "7");
+    cache.put(8, "8");
+    assert(cache.size() == 3);
+
+    auto stats = cache.stats();
+    assert(stats.size == 3 && stats.insertions == 9 && stats.evictions == 5);
+    assert(stats.hits == 2 && stats.misses == 1);
+
+    ConcurrentClockCache<int, int> sharded(1000);
+    for (int i = 0; i < 10'000; ++i) {
+        sharded.put(i, i);
+    }
+    // 1000 entries over 16 shards: the remainder goes to the first shards.
+    assert(sharded.capacity() == 1000 && sharded.size() == 1000);
+    assert(sharded.stats().evictions == 9'000);
+
+    ConcurrentClockCache<int, int> tiny(5, 16);
+    for (int i = 0; i < 100; ++i) {
+        tiny.put(i, i);
+    }
+    assert(tiny.shard_count() == 5 && tiny.capacity() == 5 && tiny.size() == 5);
+}
+
+void TestManyThreads() {
+    const int thread_count = 8;
+    const int per_thread = 50'000;
+    const int key_count = 4'000;
+    ConcurrentClockCache<int, long long> cache(1'000, 8);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&cache, t] {
+            for (int i = 0; i < per_thread; ++i) {
+                int key = static_cast<int>((i * 7919LL + t * 31) % key_count);
+                // Mostly the first keys, like a skewed workload.
+                if (i % 4 != 0) {
+                    key %= 200;
+                }
+                auto value = cache.get(key);
+                if (value.has_value()) {
+                    assert(*value == key * 3LL);
+                } else {
+                    cache.put(key, key * 3LL);
+                }
+                if (i % 1000 == 0) {
+                    cache.erase(key);
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    auto stats = cache.stats();
+    assert(stats.size <= stats.capacity);
+    assert(stats.hits + stats.misses == static_cast<size_t>(thread_count) * per_thread);
+    assert(stats.hits > stats.misses);
+    for (int key = 0; key < key_count; ++key) {
+        auto value = cache.get(key);
+        assert(!value.has_value() || *value == key * 3LL);
+    }
+}
+
+struct ThrowingCopy {
+    static inline int copies_left = -1;
+    int value;
+
+    explicit ThrowingCopy(int value) : value(value) {}
+    ThrowingCopy(const ThrowingCopy& other) : value(other.value) {
+        if (copies_left >= 0 && copies_left-- == 0) {
+            throw std::runtime_error("copy");
+        }
+    }
+    ThrowingCopy& operator=(const ThrowingCopy&) = default;
+};
+
+// A value whose copy throws leaves no half-inserted entry for the hand to visit.
+void TestThrowingValue() {
+    ConcurrentClockCache<int, ThrowingCopy> cache(4, 1);
+    ThrowingCopy value(7);
+    for (int i = 0; i < 3; ++i) {
+        cache.put(i, value);
+    }
+    ThrowingCopy::copies_left = 0;
+    bool thrown = false;
+    try {
+        cache.put(3, value);
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    ThrowingCopy::copies_left = -1;
+    assert(thrown && cache.size() == 3 && !cache.contains(3));
+
+    // Filling the shard and evicting sweeps the whole ring.
+    for (int i = 3; i < 10; ++i) {
+        cache.put(i, value);
+    }
+    assert(cache.size() == 4 && cache.get(9)->value == 7);
+
+    ThrowingCopy::copies_left = 0;
+    thrown = false;
+    try {
+        cache.put(10, value);
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    ThrowingCopy::copies_left = -1;
+    assert(thrown && cache.size() == 4 && !cache.contains(10));
+    cache.put(11, value);
+    assert(cache.size() == 4 && cache.contains(11));
+}
+
+int main() {
+    std::cerr << "Starting tests" << std::endl;
+    TestClock();
+    std::cerr << "TestClock (1 of 3) passed" << std::endl;
+    TestManyThreads();
+    std::cerr << "TestManyThreads (2 of 3) passed" << std::endl;
+    TestThrowingValue();
+    std::cerr << "TestThrowingValue (3 of 3) passed" << std::endl;
+    std::cout << 0;
+}
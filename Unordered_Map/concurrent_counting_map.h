@@ -0,0 +1,238 @@
+#ifndef UNORDERED_MAP__CONCURRENT_COUNTING_MAP_H_
+#define UNORDERED_MAP__CONCURRENT_COUNTING_MAP_H_
+
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+
+#include "unordered_map.h"
+
+// An insert-only map from integral keys to counters that never locks: a slot
+// is claimed by a CAS on its key and counted with fetch_add. A table past its
+// load limit gets a twice larger successor, and the thread that links it
+// migrates every slot by setting MOVED_ on the counter with fetch_or. An add
+// whose fetch_add returns the flag knows its delta was not carried over and
+// repeats it in the next table. Replaced tables are only freed with the map.
+template<typename Key, typename Hash = std::hash<Key>>
+class ConcurrentCountingMap {
+  static_assert(std::is_integral_v<Key>, "ConcurrentCountingMap needs integral keys");
+
+ private:
+  static const size_t DEFAULT_CAPACITY_ = 1024;
+  static const uint64_t MOVED_ = uint64_t(1) << 63;
+
+  struct Slot {
+    std::atomic<Key> key;
+    std::atomic<uint64_t> count{0};
+  };
+
+  struct Table {
+    size_t capacity;
+    // Claims stop at this many used slots, so probes stay short.
+    size_t limit;
+    std::unique_ptr<Slot[]> slots;
+    std::atomic<size_t> used{0};
+    std::atomic<bool> migrated{false};
+    std::atomic<Table*> next{nullptr};
+
+    Table(size_t, Key);
+  };
+
+  Key empty_key_;
+  Hash hasher_ = Hash();
+  PowerOfTwoBucketPolicy bucket_policy_ = PowerOfTwoBucketPolicy();
+  // The chain from first_ owns every table; table_ is the first one that is
+  // not fully migrated, where every operation starts.
+  Table* first_;
+  std::atomic<Table*> table_;
+
+  const Slot* find(const Table*, const Key&) const noexcept;
+  Slot* claim(Table*, const Key&) noexcept;
+  void add(Table*, const Key&, uint64_t);
+  Table* extend(Table*);
+  void migrate(Table*);
+
+ public:
+  // The key empty_key marks free slots and cannot be counted.
+  explicit ConcurrentCountingMap(size_t capacity = DEFAULT_CAPACITY_, const Hash& hasher = Hash(),
+                                 Key empty_key = std::numeric_limits<Key>::max());
+  ConcurrentCountingMap(const ConcurrentCountingMap&) = delete;
+  ConcurrentCountingMap& operator=(const ConcurrentCountingMap&) = delete;
+  ~ConcurrentCountingMap() noexcept;
+
+  // Counts must stay below 2^63.
+  void add(const Key&, uint64_t delta = 1);
+  // Exact once concurrent adds have finished; while a table is being migrated
+  // a concurrent read may miss or double a count that is in flight.
+  uint64_t get(const Key&) const noexcept;
+  size_t capacity() const noexcept;
+  UnorderedMap<Key, uint64_t, Hash> snapshot() const;
+};
+
+template<typename Key, typename Hash>
+ConcurrentCountingMap<Key, Hash>::Table::Table(size_t capacity, Key empty_key) :
+    capacity(capacity), limit(capacity - capacity / 4), slots(new Slot[capacity]) {
+  for (size_t i = 0; i < capacity; ++i) {
+    slots[i].key.store(empty_key, std::memory_order_relaxed);
+  }
+}
+
+template<typename Key, typename Hash>
+ConcurrentCountingMap<Key, Hash>::ConcurrentCountingMap(size_t capacity, const Hash& hasher, Key empty_key) :
+    empty_key_(empty_key), hasher_(hasher),
+    first_(new Table(bucket_policy_.bucket_count(std::max(capacity, size_t(2))), empty_key)),
+    table_(first_) {}
+
+template<typename Key, typename Hash>
+ConcurrentCountingMap<Key, Hash>::~ConcurrentCountingMap() noexcept {
+  for (Table* table = first_; table != nullptr;) {
+    Table* next = table->next.load(std::memory_order_relaxed);
+    delete table;
+    table = next;
+  }
+}
+
+template<typename Key, typename Hash>
+const typename ConcurrentCountingMap<Key, Hash>::Slot*
+ConcurrentCountingMap<Key, Hash>::find(const Table* table, const Key& key) const noexcept {
+  size_t index = bucket_policy_(hasher_(key), table->capacity);
+  for (size_t probe = 0; probe < table->capacity; ++probe, index = (index + 1) & (table->capacity - 1)) {
+    Key current = table->slots[index].key.load(std::memory_order_acquire);
+    if (current == key) {
+      return &table->slots[index];
+    }
+    if (current == empty_key_) {
+      break;
+    }
+  }
+  return nullptr;
+}
+
+// Slots are never freed, so a key sits before the first free slot of its probe
+// sequence; reaching a free slot in a full table means the key is not here.
+template<typename Key, typename Hash>
+typename ConcurrentCountingMap<Key, Hash>::Slot*
+ConcurrentCountingMap<Key, Hash>::claim(Table* table, const Key& key) noexcept {
+  size_t index = bucket_policy_(hasher_(key), table->capacity);
+  for (size_t probe = 0; probe < table->capacity; ++probe, index = (index + 1) & (table->capacity - 1)) {
+    Slot& slot = table->slots[index];
+    Key current = slot.key.load(std::memory_order_acquire);
+    if (current == empty_key_) {
+      if (table->used.load(std::memory_order_relaxed) >= table->limit) {
+        return nullptr;
+      }
+      if (slot.key.compare_exchange_strong(current, key, std::memory_order_acq_rel)) {
+        table->used.fetch_add(1, std::memory_order_relaxed);
+        return &slot;
+      }
+    }
+    if (current == key) {
+      return &slot;
+    }
+  }
+  return nullptr;
+}
+
+template<typename Key, typename Hash>
+void ConcurrentCountingMap<Key, Hash>::add(Table* table, const Key& key, uint64_t delta) {
+  while (true) {
+    Slot* slot = claim(table, key);
+    if (slot != nullptr && (slot->count.fetch_add(delta, std::memory_order_acq_rel) & MOVED_) == 0) {
+      return;
+    }
+    table = extend(table);
+  }
+}
+
+template<typename Key, typename Hash>
+typename ConcurrentCountingMap<Key, Hash>::Table*
+ConcurrentCountingMap<Key, Hash>::extend(Table* table) {
+  Table* next = table->next.load(std::memory_order_acquire);
+  if (next != nullptr) {
+    return next;
+  }
+  auto* created = new Table(2 * table->capacity, empty_key_);
+  if (!table->next.compare_exchange_strong(next, created, std::memory_order_acq_rel)) {
+    delete created;
+    return next;
+  }
+  migrate(table);
+  return created;
+}
+
+// Adds that reach a slot before its flag is set are carried over with it.
+template<typename Key, typename Hash>
+void ConcurrentCountingMap<Key, Hash>::migrate(Table* table) {
+  Table* next = table->next.load(std::memory_order_acquire);
+  for (size_t i = 0; i < table->capacity; ++i) {
+    Slot& slot = table->slots[i];
+    uint64_t count = slot.count.fetch_or(MOVED_, std::memory_order_acq_rel);
+    if (count != 0) {
+      add(next, slot.key.load(std::memory_order_acquire), count);
+    }
+  }
+  table->migrated.store(true, std::memory_order_release);
+  // A successor may have finished migrating first; skip it as well.
+  Table* head = table_.load(std::memory_order_acquire);
+  while (head->migrated.load(std::memory_order_acquire)) {
+    Table* successor = head->next.load(std::memory_order_acquire);
+    if (table_.compare_exchange_weak(head, successor, std::memory_order_acq_rel)) {
+      head = successor;
+    }
+  }
+}
+
+template<typename Key, typename Hash>
+void ConcurrentCountingMap<Key, Hash>::add(const Key& key, uint64_t delta) {
+  if (key == empty_key_) {
+    throw std::invalid_argument("the empty key cannot be counted");
+  }
+  add(table_.load(std::memory_order_acquire), key, delta);
+}
+
+template<typename Key, typename Hash>
+uint64_t ConcurrentCountingMap<Key, Hash>::get(const Key& key) const noexcept {
+  uint64_t result = 0;
+  for (const Table* table = table_.load(std::memory_order_acquire); table != nullptr;
+       table = table->next.load(std::memory_order_acquire)) {
+    const Slot* slot = find(table, key);
+    if (slot != nullptr) {
+      uint64_t count = slot->count.load(std::memory_order_acquire);
+      result += (count & MOVED_) == 0 ? count : 0;
+    }
+  }
+  return result;
+}
+
+template<typename Key, typename Hash>
+size_t ConcurrentCountingMap<Key, Hash>::capacity() const noexcept {
+  const Table* table = table_.load(std::memory_order_acquire);
+  for (const Table* next = table->next.load(std::memory_order_acquire); next != nullptr;
+       next = next->next.load(std::memory_order_acquire)) {
+    table = next;
+  }
+  return table->capacity;
+}
+
+template<typename Key, typename Hash>
+UnorderedMap<Key, uint64_t, Hash> ConcurrentCountingMap<Key, Hash>::snapshot() const {
+  UnorderedMap<Key, uint64_t, Hash> result(0, hasher_, std::equal_to<Key>(),
+                                           std::allocator<std::pair<const Key, uint64_t>>());
+  const Table* head = table_.load(std::memory_order_acquire);
+  for (const Table* table = head; table != nullptr; table = table->next.load(std::memory_order_acquire)) {
+    result.reserve(result.size() + table->used.load(std::memory_order_relaxed));
+  }
+  for (const Table* table = head; table != nullptr; table = table->next.load(std::memory_order_acquire)) {
+    for (size_t i = 0; i < table->capacity; ++i) {
+      uint64_t count = table->slots[i].count.load(std::memory_order_acquire);
+      if (count != 0 && (count & MOVED_) == 0) {
+        result[table->slots[i].key.load(std::memory_order_acquire)] += count;
+      }
+    }
+  }
+  return result;
+}
+
+#endif //UNORDERED_MAP__CONCURRENT_COUNTING_MAP_H_
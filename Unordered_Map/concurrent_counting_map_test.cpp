@@ -0,0 +1,85 @@
+#include "concurrent_counting_map.h"
+
+#include <cassert>
+#include <thread>
+#include <vector>
+
+void TestSingleThread() {
+    ConcurrentCountingMap<int> m(4);
+    m.add(1);
+    m.add(2, 10);
+    m.add(1);
+    assert(m.get(1) == 2 && m.get(2) == 10 && m.get(3) == 0);
+
+    for (int i = 0; i < 10'000; ++i) {
+        m.add(i % 1000, 3);
+    }
+    assert(m.capacity() >= 1000);
+    assert(m.get(1) == 32 && m.get(999) == 30 && m.get(1000) == 0);
+
+    auto snapshot = m.snapshot();
+    assert(snapshot.size() == 1000);
+    assert(snapshot.at(2) == 40 && snapshot.at(500) == 30);
+
+    bool thrown = false;
+    try {
+        m.add(std::numeric_limits<int>::max());
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    ConcurrentCountingMap<uint8_t> bytes(2, std::hash<uint8_t>(), 0);
+    for (int i = 0; i < 1000; ++i) {
+        bytes.add(static_cast<uint8_t>(i % 255 + 1));
+    }
+    assert(bytes.snapshot().size() == 255 && bytes.get(255) == 3 && bytes.get(1) == 4);
+}
+
+void TestManyThreads() {
+    const int thread_count = 8;
+    const int per_thread = 50'000;
+    const int key_count = 20'000;
+    // A tiny start forces several resizes while every thread is counting.
+    ConcurrentCountingMap<long long> m(16);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&m, t] {
+            for (int i = 0; i < per_thread; ++i) {
+                m.add((i * 7919LL + t) % key_count, 1 + i % 2);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    std::vector<uint64_t> expected(key_count, 0);
+    for (int t = 0; t < thread_count; ++t) {
+        for (int i = 0; i < per_thread; ++i) {
+            expected[(i * 7919LL + t) % key_count] += 1 + i % 2;
+        }
+    }
+    auto snapshot = m.snapshot();
+    uint64_t total = 0;
+    for (int key = 0; key < key_count; ++key) {
+        assert(m.get(key) == expected[key]);
+        assert(expected[key] == 0 || snapshot.at(key) == expected[key]);
+        total += expected[key];
+    }
+    uint64_t snapshot_total = 0;
+    for (const auto& kv : snapshot) {
+        snapshot_total += kv.second;
+    }
+    assert(snapshot_total == total);
+}
+
+int main() {
+    std::cerr << "Starting tests" << std::endl;
+    TestSingleThread();
+    std::cerr << "TestSingleThread (1 of 2) passed" << std::endl;
+    TestManyThreads();
+    std::cerr << "TestManyThreads (2 of 2) passed" << std::endl;
+    std::cout << 0;
+}
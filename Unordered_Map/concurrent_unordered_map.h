@@ -0,0 +1,179 @@
+#ifndef UNORDERED_MAP__CONCURRENT_UNORDERED_MAP_H_
+#define UNORDERED_MAP__CONCURRENT_UNORDERED_MAP_H_
+
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+
+#include "unordered_map.h"
+
+// Keys are spread over independently locked UnorderedMap shards by
+// shard_of(), which says nothing about the bucket inside the shard; values
+// are returned by copy since iterators cannot outlive the shard lock.
+template<typename Key, typename Value, typename Hash = std::hash<Key>,
+    typename Equal = std::equal_to<Key>,
+    typename Alloc = std::allocator<std::pair<const Key, Value>>,
+    typename BucketPolicy = ModuloBucketPolicy>
+class ConcurrentUnorderedMap {
+ public:
+  using map_type = UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>;
+  using node_type = typename map_type::node_type;
+
+ private:
+  static const size_t DEFAULT_SHARD_COUNT_ = 16;
+  static const size_t DEFAULT_SHARD_TABLE_SIZE_ = 64;
+
+  struct alignas(64) Shard {
+    mutable std::shared_mutex mutex;
+    map_type map;
+  };
+
+  size_t shard_count_;
+  std::unique_ptr<Shard[]> shards_;
+  Hash hasher_;
+
+  Shard& get_shard(const Key&) const noexcept;
+
+ public:
+  ConcurrentUnorderedMap();
+  ConcurrentUnorderedMap(size_t, const Hash& hasher = Hash(),
+                         const Equal& key_equal = Equal(), const Alloc& alloc = Alloc());
+  ConcurrentUnorderedMap(const ConcurrentUnorderedMap&) = delete;
+  ConcurrentUnorderedMap& operator=(const ConcurrentUnorderedMap&) = delete;
+
+  size_t shard_count() const noexcept;
+  size_t size() const;
+  void reserve(size_t);
+  typename map_type::Stats shard_stats(size_t) const;
+
+  std::optional<Value> find(const Key&) const;
+  bool contains(const Key&) const;
+
+  bool insert(const node_type&);
+  bool insert(node_type&&);
+  bool erase(const Key&);
+
+  template<typename Function>
+  bool update(const Key&, Function&&);
+  template<typename Function>
+  void visit(Function&&) const;
+};
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+ConcurrentUnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::ConcurrentUnorderedMap() :
+    ConcurrentUnorderedMap(DEFAULT_SHARD_COUNT_) {}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+ConcurrentUnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::ConcurrentUnorderedMap(
+    size_t shard_count, const Hash& hasher, const Equal& key_equal, const Alloc& alloc) :
+    shard_count_(shard_count == 0 ? 1 : shard_count), shards_(new Shard[shard_count_]), hasher_(hasher) {
+  for (size_t i = 0; i < shard_count_; ++i) {
+    shards_[i].map = map_type(DEFAULT_SHARD_TABLE_SIZE_, hasher, key_equal, alloc);
+  }
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+typename ConcurrentUnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::Shard&
+ConcurrentUnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::get_shard(const Key& key) const noexcept {
+  return shards_[shard_of(hasher_(key), shard_count_)];
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+size_t ConcurrentUnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::shard_count() const noexcept {
+  return shard_count_;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+size_t ConcurrentUnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::size() const {
+  std::vector<std::shared_lock<std::shared_mutex>> locks;
+  locks.reserve(shard_count_);
+  size_t result = 0;
+  for (size_t i = 0; i < shard_count_; ++i) {
+    locks.emplace_back(shards_[i].mutex);
+    result += shards_[i].map.size();
+  }
+  return result;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+void ConcurrentUnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::reserve(size_t count) {
+  for (size_t i = 0; i < shard_count_; ++i) {
+    std::unique_lock<std::shared_mutex> lock(shards_[i].mutex);
+    shards_[i].map.reserve(count / shard_count_ + 1);
+  }
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+typename ConcurrentUnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::map_type::Stats
+ConcurrentUnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::shard_stats(size_t shard) const {
+  std::shared_lock<std::shared_mutex> lock(shards_[shard].mutex);
+  return shards_[shard].map.stats();
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+std::optional<Value> ConcurrentUnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::find(
+    const Key& key) const {
+  Shard& shard = get_shard(key);
+  std::shared_lock<std::shared_mutex> lock(shard.mutex);
+  auto it = shard.map.find(key);
+  if (it == shard.map.end()) {
+    return std::nullopt;
+  }
+  return it->second;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+bool ConcurrentUnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::contains(const Key& key) const {
+  Shard& shard = get_shard(key);
+  std::shared_lock<std::shared_mutex> lock(shard.mutex);
+  return shard.map.contains(key);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+bool ConcurrentUnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::insert(const node_type& kv) {
+  Shard& shard = get_shard(kv.first);
+  std::unique_lock<std::shared_mutex> lock(shard.mutex);
+  return shard.map.insert(kv).second;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+bool ConcurrentUnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::insert(node_type&& kv) {
+  Shard& shard = get_shard(kv.first);
+  std::unique_lock<std::shared_mutex> lock(shard.mutex);
+  return shard.map.insert(std::move(kv)).second;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+bool ConcurrentUnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::erase(const Key& key) {
+  Shard& shard = get_shard(key);
+  std::unique_lock<std::shared_mutex> lock(shard.mutex);
+  return shard.map.erase(key) > 0;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+template<typename Function>
+bool ConcurrentUnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::update(
+    const Key& key, Function&& function) {
+  Shard& shard = get_shard(key);
+  std::unique_lock<std::shared_mutex> lock(shard.mutex);
+  auto it = shard.map.find(key);
+  if (it == shard.map.end()) {
+    return false;
+  }
+  function(it->second);
+  return true;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+template<typename Function>
+void ConcurrentUnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::visit(Function&& function) const {
+  for (size_t i = 0; i < shard_count_; ++i) {
+    std::shared_lock<std::shared_mutex> lock(shards_[i].mutex);
+    for (auto it = shards_[i].map.cbegin(); it != shards_[i].map.cend(); ++it) {
+      function(*it);
+    }
+  }
+}
+
+#endif //UNORDERED_MAP__CONCURRENT_UNORDERED_MAP_H_
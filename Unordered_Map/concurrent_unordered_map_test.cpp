@@ -0,0 +1,108 @@
+#include "concurrent_unordered_map.h"
+
+#include <cassert>
+#include <string>
+#include <thread>
+#include <vector>
+
+void TestSingleThread() {
+    ConcurrentUnorderedMap<std::string, int> m(4);
+    assert(m.shard_count() == 4);
+
+    assert(m.insert({"a", 1}));
+    assert(m.insert({"b", 2}));
+    assert(!m.insert({"a", 3}));
+    assert(m.size() == 2);
+
+    assert(m.find("a") == 1);
+    assert(!m.find("c").has_value());
+    assert(m.contains("b"));
+
+    assert(m.update("b", [](int& value) { value += 40; }));
+    assert(!m.update("c", [](int& value) { value = 0; }));
+    assert(m.find("b") == 42);
+
+    int sum = 0;
+    m.visit([&sum](const std::pair<const std::string, int>& kv) { sum += kv.second; });
+    assert(sum == 43);
+
+    assert(m.erase("a"));
+    assert(!m.erase("a"));
+    assert(m.size() == 1);
+}
+
+void TestManyThreads() {
+    const int thread_count = 8;
+    const int per_thread = 20'000;
+    ConcurrentUnorderedMap<int, int> m;
+    m.reserve(thread_count * per_thread);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&m, t] {
+            for (int i = t * per_thread; i < (t + 1) * per_thread; ++i) {
+                m.insert({i, 0});
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    threads.clear();
+    assert(m.size() == thread_count * per_thread);
+
+    // Every thread increments every key once and erases its own odd keys.
+    for (int t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&m, t] {
+            for (int i = 0; i < thread_count * per_thread; ++i) {
+                m.update(i, [](int& value) { ++value; });
+            }
+            for (int i = t * per_thread + 1; i < (t + 1) * per_thread; i += 2) {
+                assert(m.erase(i));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    assert(m.size() == thread_count * per_thread / 2);
+    for (int i = 0; i < thread_count * per_thread; ++i) {
+        auto value = m.find(i);
+        assert(value.has_value() == (i % 2 == 0));
+        assert(i % 2 != 0 || *value == thread_count);
+    }
+}
+
+// The shard must not be picked from the bits the in-shard policy uses.
+template<typename BucketPolicy>
+void TestShardOccupancy() {
+    ConcurrentUnorderedMap<int, int, std::hash<int>, std::equal_to<int>,
+                           std::allocator<std::pair<const int, int>>, BucketPolicy> m;
+    for (int i = 0; i < 64'000; ++i) {
+        m.insert({i, i});
+    }
+    for (size_t shard = 0; shard < m.shard_count(); ++shard) {
+        auto stats = m.shard_stats(shard);
+        assert(stats.size > 3000 && stats.size < 5000);
+        // About e^-load of the buckets stay empty at a load of at most 0.66.
+        assert(stats.empty_bucket_ratio < 0.75 && stats.max_chain_length < 10);
+    }
+}
+
+void TestShardPolicies() {
+    TestShardOccupancy<ModuloBucketPolicy>();
+    TestShardOccupancy<PowerOfTwoBucketPolicy>();
+    TestShardOccupancy<FastRangeBucketPolicy>();
+}
+
+int main() {
+    std::cerr << "Starting tests" << std::endl;
+    TestSingleThread();
+    std::cerr << "TestSingleThread (1 of 3) passed" << std::endl;
+    TestManyThreads();
+    std::cerr << "TestManyThreads (2 of 3) passed" << std::endl;
+    TestShardPolicies();
+    std::cerr << "TestShardPolicies (3 of 3) passed" << std::endl;
+    std::cout << 0;
+}
@@ -0,0 +1,782 @@
+#ifndef UNORDERED_MAP__CUCKOO_MAP_H_
+#define UNORDERED_MAP__CUCKOO_MAP_H_
+
+#include <cstdint>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "unordered_map.h"
+
+// Slots per CuckooMap bucket: as many as fit in one cache line next to their
+// one-byte tags, up to 4, but never fewer than 2.
+template<typename T>
+constexpr size_t cuckoo_slot_count() noexcept {
+  for (size_t slots = 4; slots > 2; --slots) {
+    size_t tag_bytes = (slots + alignof(T) - 1) / alignof(T) * alignof(T);
+    if (tag_bytes + slots * sizeof(T) <= 64) {
+      return slots;
+    }
+  }
+  return 2;
+}
+
+// A bucketized cuckoo hash map: every key lives in one of two buckets, so a
+// lookup reads at most two buckets whatever the load. A bucket keeps a
+// one-byte tag per slot and the slots themselves inline, aligned to a cache
+// line, and holds as many slots as fit in that line: 4 for small entries, 3
+// for 16-byte ones such as <long long, long long>. Entries of more than 31
+// bytes get 2 slots and a bucket spans several lines; only for those does a
+// lookup read more than two lines. The second
+// bucket is derived from the first and the tag alone, so entries are moved
+// between their buckets without rehashing the key. An insert into two full
+// buckets searches breadth-first for the shortest chain of such moves that
+// ends in a free slot, and grows the table if none is short enough. More
+// than 2 * SLOTS_ keys with one hash never fit, and inserting one more throws
+// std::length_error. Inserting may move other entries and invalidates
+// iterators.
+template<typename Key, typename Value, typename Hash = std::hash<Key>,
+    typename Equal = std::equal_to<Key>,
+    typename Alloc = std::allocator<std::pair<const Key, Value>>>
+class CuckooMap {
+ private:
+  template<bool is_const>
+  class CommonIterator;
+
+ public:
+  using AllocTraits = std::allocator_traits<Alloc>;
+  using node_type = std::pair<const Key, Value>;
+  using iterator = CommonIterator<false>;
+  using const_iterator = CommonIterator<true>;
+
+ private:
+  static const size_t SLOTS_ = cuckoo_slot_count<node_type>();
+  static const size_t DEFAULT_BUCKET_COUNT_ = 16;
+  // An eviction search visits at most MAX_SEARCH_ buckets and finds paths
+  // of at most MAX_PATH_ moves; beyond that the table grows instead.
+  static const size_t MAX_SEARCH_ = 256;
+  static const size_t MAX_PATH_ = 4;
+  static const uint8_t FREE_ = 0;
+  // Growing that many times in a row without making room gives up.
+  static const size_t MAX_GROWTHS_ = 4;
+
+  struct alignas(64) Bucket {
+    uint8_t tags[SLOTS_] = {};
+    alignas(node_type) unsigned char slots[SLOTS_][sizeof(node_type)];
+
+    node_type* slot(size_t) noexcept;
+  };
+
+  static_assert(sizeof(node_type) > 31 || sizeof(Bucket) == 64, "a CuckooMap bucket should be one cache line");
+
+  // Where rehash is going to put every entry, found before any is moved:
+  // sources[i] is the old bucket * SLOTS_ + slot of the entry in slot i.
+  struct PlannedBucket {
+    uint8_t tags[SLOTS_] = {};
+    size_t sources[SLOTS_];
+  };
+
+  // One bucket of the eviction search: reached from slot `slot` of the
+  // bucket at `parent` in the queue.
+  struct SearchStep {
+    size_t bucket;
+    size_t parent;
+    size_t slot;
+    size_t depth;
+  };
+
+  using BucketAlloc = typename AllocTraits::template rebind_alloc<Bucket>;
+
+  // Two slots per bucket stop filling up at about 0.89.
+  float max_load_factor_ = SLOTS_ == 2 ? 0.85 : 0.9;
+  size_t size_ = 0;
+  Alloc allocator_ = Alloc();
+  std::vector<Bucket, BucketAlloc> buckets_ = std::vector<Bucket, BucketAlloc>(DEFAULT_BUCKET_COUNT_, allocator_);
+  Equal key_equal_ = Equal();
+  Hash hasher_ = Hash();
+
+  size_t get_hash(const Key&) const noexcept;
+  static uint8_t get_tag(size_t) noexcept;
+  size_t get_bucket(size_t) const noexcept;
+  static size_t alternate_bucket(size_t, uint8_t, size_t) noexcept;
+
+  iterator make_iterator(size_t, size_t) noexcept;
+  std::pair<size_t, size_t> find_slot(const Key&, size_t) const noexcept;
+  // Returns an untagged free slot in one of the key's buckets, moving other
+  // entries or growing the table if needed.
+  std::pair<size_t, size_t> make_slot(size_t);
+  // Works on buckets_ or on a rehash plan, moving entries with move(from
+  // bucket, from slot, to bucket, to slot).
+  template<typename Table, typename Move>
+  bool make_free_slot(Table&, size_t, size_t, std::pair<size_t, size_t>&, Move&&) const;
+  void move_slot(size_t, size_t, size_t, size_t);
+  // Whether every slot of both buckets holds a key with this hash, so no
+  // table size can make room for one more.
+  bool shares_hash(size_t, size_t, size_t) const;
+  bool plan_rehash(std::vector<PlannedBucket>&, size_t) const;
+  template<typename... Args>
+  iterator construct_at(size_t, Args&& ...);
+  void destroy_elements() noexcept;
+
+ public:
+  CuckooMap();
+  CuckooMap(size_t, const Hash& hasher = Hash(), const Equal& key_equal = Equal(),
+            const Alloc& alloc = Alloc());
+  CuckooMap(const CuckooMap&);
+  CuckooMap& operator=(const CuckooMap&);
+  CuckooMap(CuckooMap&&) noexcept;
+  CuckooMap& operator=(CuckooMap&&) noexcept;
+  ~CuckooMap() noexcept;
+
+  size_t size() const noexcept;
+
+  iterator find(const Key&) noexcept;
+  const_iterator find(const Key&) const noexcept;
+  bool contains(const Key&) const noexcept;
+  size_t count(const Key&) const noexcept;
+
+  template<typename... Args>
+  std::pair<iterator, bool> emplace(Args&& ...);
+  std::pair<iterator, bool> insert(const node_type&);
+  std::pair<iterator, bool> insert(node_type&&);
+  template<typename InputIterator>
+  void insert(const InputIterator&, const InputIterator&);
+
+  void erase(const iterator&) noexcept;
+  size_t erase(const Key&) noexcept;
+
+  Value& operator[](const Key&);
+  Value& at(const Key&);
+  const Value& at(const Key&) const;
+
+  void reserve(size_t);
+  // Rebuilds the table with at least the given number of buckets.
+  void rehash(size_t);
+  size_t max_size() const noexcept;
+  float max_load_factor() const noexcept;
+  void max_load_factor(float);
+  float load_factor() const noexcept;
+  size_t bucket_count() const noexcept;
+
+  iterator begin() noexcept;
+  const_iterator begin() const noexcept;
+  const_iterator cbegin() const noexcept;
+  iterator end() noexcept;
+  const_iterator end() const noexcept;
+  const_iterator cend() const noexcept;
+};
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+template<bool is_const>
+class CuckooMap<Key, Value, Hash, Equal, Alloc>::CommonIterator {
+ private:
+  using BucketPointer = typename std::conditional<is_const, const Bucket*, Bucket*>::type;
+
+  BucketPointer bucket_ = nullptr;
+  BucketPointer end_ = nullptr;
+  size_t slot_ = 0;
+
+  void skip_free() noexcept;
+
+  friend class CuckooMap;
+
+ public:
+  CommonIterator() noexcept = default;
+  CommonIterator(BucketPointer, BucketPointer, size_t) noexcept;
+
+  using value_type = node_type;
+  using iterator_category = std::forward_iterator_tag;
+  using difference_type = ssize_t;
+  using reference = typename std::conditional<is_const, const node_type&, node_type&>::type;
+  using pointer = typename std::conditional<is_const, const node_type*, node_type*>::type;
+
+  operator CommonIterator<true>() const noexcept;
+
+  CommonIterator<is_const>& operator++() noexcept;
+  CommonIterator<is_const> operator++(int) noexcept;
+
+  reference operator*() const noexcept;
+  pointer operator->() const noexcept;
+
+  bool operator==(const CommonIterator<is_const>&) const noexcept;
+  bool operator!=(const CommonIterator<is_const>&) const noexcept;
+};
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+typename CuckooMap<Key, Value, Hash, Equal, Alloc>::node_type*
+CuckooMap<Key, Value, Hash, Equal, Alloc>::Bucket::slot(size_t index) noexcept {
+  return reinterpret_cast<node_type*>(slots[index]);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+template<bool is_const>
+CuckooMap<Key, Value, Hash, Equal, Alloc>::CommonIterator<is_const>::CommonIterator(
+    BucketPointer bucket, BucketPointer end, size_t slot) noexcept : bucket_(bucket), end_(end), slot_(slot) {}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+template<bool is_const>
+void CuckooMap<Key, Value, Hash, Equal, Alloc>::CommonIterator<is_const>::skip_free() noexcept {
+  while (bucket_ != end_ && bucket_->tags[slot_] == FREE_) {
+    if (++slot_ == SLOTS_) {
+      slot_ = 0;
+      ++bucket_;
+    }
+  }
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+template<bool is_const>
+CuckooMap<Key, Value, Hash, Equal, Alloc>::CommonIterator<is_const>::operator CommonIterator<true>() const noexcept {
+  return CommonIterator<true>(bucket_, end_, slot_);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+template<bool is_const>
+typename CuckooMap<Key, Value, Hash, Equal, Alloc>::template CommonIterator<is_const>&
+CuckooMap<Key, Value, Hash, Equal, Alloc>::CommonIterator<is_const>::operator++() noexcept {
+  if (++slot_ == SLOTS_) {
+    slot_ = 0;
+    ++bucket_;
+  }
+  skip_free();
+  return *this;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+template<bool is_const>
+typename CuckooMap<Key, Value, Hash, Equal, Alloc>::template CommonIterator<is_const>
+CuckooMap<Key, Value, Hash, Equal, Alloc>::CommonIterator<is_const>::operator++(int) noexcept {
+  CommonIterator<is_const> tmp(*this);
+  ++(*this);
+  return tmp;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+template<bool is_const>
+typename CuckooMap<Key, Value, Hash, Equal, Alloc>::template CommonIterator<is_const>::reference
+CuckooMap<Key, Value, Hash, Equal, Alloc>::CommonIterator<is_const>::operator*() const noexcept {
+  return *operator->();
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+template<bool is_const>
+typename CuckooMap<Key, Value, Hash, Equal, Alloc>::template CommonIterator<is_const>::pointer
+CuckooMap<Key, Value, Hash, Equal, Alloc>::CommonIterator<is_const>::operator->() const noexcept {
+  return const_cast<Bucket*>(bucket_)->slot(slot_);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+template<bool is_const>
+bool CuckooMap<Key, Value, Hash, Equal, Alloc>::CommonIterator<is_const>::operator==(
+    const CommonIterator<is_const>& other) const noexcept {
+  return bucket_ == other.bucket_ && slot_ == other.slot_;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+template<bool is_const>
+bool CuckooMap<Key, Value, Hash, Equal, Alloc>::CommonIterator<is_const>::operator!=(
+    const CommonIterator<is_const>& other) const noexcept {
+  return !(*this == other);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+CuckooMap<Key, Value, Hash, Equal, Alloc>::CuckooMap() = default;
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+CuckooMap<Key, Value, Hash, Equal, Alloc>::CuckooMap(
+    size_t bucket_count, const Hash& hasher, const Equal& key_equal, const Alloc& alloc) :
+    allocator_(alloc),
+    buckets_(PowerOfTwoBucketPolicy().bucket_count(std::max(bucket_count, size_t(2))), BucketAlloc(alloc)),
+    key_equal_(key_equal), hasher_(hasher) {}
+
+// Hashes are unchanged, so every entry is copied into the same slot.
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+CuckooMap<Key, Value, Hash, Equal, Alloc>::CuckooMap(const CuckooMap& other) :
+    CuckooMap(other.buckets_.size(), other.hasher_, other.key_equal_,
+              AllocTraits::select_on_container_copy_construction(other.allocator_)) {
+  max_load_factor_ = other.max_load_factor_;
+  try {
+    for (size_t i = 0; i < buckets_.size(); ++i) {
+      for (size_t slot = 0; slot < SLOTS_; ++slot) {
+        if (other.buckets_[i].tags[slot] != FREE_) {
+          AllocTraits::construct(allocator_, buckets_[i].slot(slot),
+                                 *const_cast<Bucket&>(other.buckets_[i]).slot(slot));
+          buckets_[i].tags[slot] = other.buckets_[i].tags[slot];
+          ++size_;
+        }
+      }
+    }
+  } catch (...) {
+    destroy_elements();
+    throw;
+  }
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+CuckooMap<Key, Value, Hash, Equal, Alloc>&
+CuckooMap<Key, Value, Hash, Equal, Alloc>::operator=(const CuckooMap& other) {
+  if (this != &other) {
+    CuckooMap tmp(other);
+    *this = std::move(tmp);
+  }
+  return *this;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+CuckooMap<Key, Value, Hash, Equal, Alloc>::CuckooMap(CuckooMap&& other) noexcept :
+    max_load_factor_(other.max_load_factor_), size_(other.size_), allocator_(std::move(other.allocator_)),
+    buckets_(std::move(other.buckets_)), key_equal_(std::move(other.key_equal_)),
+    hasher_(std::move(other.hasher_)) {
+  other.size_ = 0;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+CuckooMap<Key, Value, Hash, Equal, Alloc>&
+CuckooMap<Key, Value, Hash, Equal, Alloc>::operator=(CuckooMap&& other) noexcept {
+  if (this != &other) {
+    destroy_elements();
+    max_load_factor_ = other.max_load_factor_;
+    size_ = other.size_;
+    allocator_ = std::move(other.allocator_);
+    buckets_ = std::move(other.buckets_);
+    key_equal_ = std::move(other.key_equal_);
+    hasher_ = std::move(other.hasher_);
+    other.size_ = 0;
+  }
+  return *this;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+CuckooMap<Key, Value, Hash, Equal, Alloc>::~CuckooMap() noexcept {
+  destroy_elements();
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+void CuckooMap<Key, Value, Hash, Equal, Alloc>::destroy_elements() noexcept {
+  for (auto& bucket : buckets_) {
+    for (size_t slot = 0; slot < SLOTS_; ++slot) {
+      if (bucket.tags[slot] != FREE_) {
+        AllocTraits::destroy(allocator_, bucket.slot(slot));
+        bucket.tags[slot] = FREE_;
+      }
+    }
+  }
+  size_ = 0;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+size_t CuckooMap<Key, Value, Hash, Equal, Alloc>::get_hash(const Key& key) const noexcept {
+  return mix_hash(hasher_(key));
+}
+
+// Never FREE_; odd, so the two buckets of a key always differ.
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+uint8_t CuckooMap<Key, Value, Hash, Equal, Alloc>::get_tag(size_t hash) noexcept {
+  return static_cast<uint8_t>(hash >> 56) | 1;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+size_t CuckooMap<Key, Value, Hash, Equal, Alloc>::get_bucket(size_t hash) const noexcept {
+  return hash & (buckets_.size() - 1);
+}
+
+// An involution: applied to either bucket of a key it gives the other one.
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+size_t CuckooMap<Key, Value, Hash, Equal, Alloc>::alternate_bucket(
+    size_t bucket, uint8_t tag, size_t bucket_count) noexcept {
+  return (bucket ^ (tag * 0x5bd1e995ULL)) & (bucket_count - 1);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+typename CuckooMap<Key, Value, Hash, Equal, Alloc>::iterator
+CuckooMap<Key, Value, Hash, Equal, Alloc>::make_iterator(size_t bucket, size_t slot) noexcept {
+  return iterator(buckets_.data() + bucket, buckets_.data() + buckets_.size(), slot);
+}
+
+// Returns {bucket_count(), 0}, the position of end(), for a missing key.
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+std::pair<size_t, size_t> CuckooMap<Key, Value, Hash, Equal, Alloc>::find_slot(
+    const Key& key, size_t hash) const noexcept {
+  // A moved-from map has no buckets until the next insert.
+  if (buckets_.empty()) {
+    return {0, 0};
+  }
+  uint8_t tag = get_tag(hash);
+  size_t first = get_bucket(hash);
+  size_t second = alternate_bucket(first, tag, buckets_.size());
+  __builtin_prefetch(&buckets_[second]);
+  for (size_t bucket : {first, second}) {
+    auto& candidate = const_cast<Bucket&>(buckets_[bucket]);
+    for (size_t slot = 0; slot < SLOTS_; ++slot) {
+      if (candidate.tags[slot] == tag && key_equal_(key, candidate.slot(slot)->first)) {
+        return {bucket, slot};
+      }
+    }
+  }
+  return {buckets_.size(), 0};
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+void CuckooMap<Key, Value, Hash, Equal, Alloc>::move_slot(
+    size_t from_bucket, size_t from_slot, size_t to_bucket, size_t to_slot) {
+  auto& from = buckets_[from_bucket];
+  auto& to = buckets_[to_bucket];
+  AllocTraits::construct(allocator_, to.slot(to_slot), std::move(*from.slot(from_slot)));
+  to.tags[to_slot] = from.tags[from_slot];
+  AllocTraits::destroy(allocator_, from.slot(from_slot));
+  from.tags[from_slot] = FREE_;
+}
+
+// Breadth-first over the buckets reachable by moving entries to their other
+// bucket; the first bucket with a free slot ends the shortest path, which is
+// then applied from its end so that every move lands in a free slot.
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+template<typename Table, typename Move>
+bool CuckooMap<Key, Value, Hash, Equal, Alloc>::make_free_slot(
+    Table& table, size_t first, size_t second, std::pair<size_t, size_t>& result, Move&& move) const {
+  SearchStep queue[MAX_SEARCH_];
+  size_t queue_size = 0;
+  queue[queue_size++] = {first, MAX_SEARCH_, 0, 0};
+  queue[queue_size++] = {second, MAX_SEARCH_, 0, 0};
+  for (size_t head = 0; head < queue_size; ++head) {
+    SearchStep step = queue[head];
+    auto& bucket = table[step.bucket];
+    for (size_t slot = 0; slot < SLOTS_; ++slot) {
+      if (bucket.tags[slot] != FREE_) {
+        continue;
+      }
+      while (step.parent != MAX_SEARCH_) {
+        const SearchStep& parent = queue[step.parent];
+        move(parent.bucket, step.slot, step.bucket, slot);
+        slot = step.slot;
+        step = parent;
+      }
+      result = {step.bucket, slot};
+      return true;
+    }
+    if (step.depth == MAX_PATH_) {
+      continue;
+    }
+    for (size_t slot = 0; slot < SLOTS_ && queue_size < MAX_SEARCH_; ++slot) {
+      size_t next = alternate_bucket(step.bucket, bucket.tags[slot], table.size());
+      bool on_path = false;
+      for (size_t i = head; i != MAX_SEARCH_ && !on_path; i = queue[i].parent) {
+        on_path = queue[i].bucket == next;
+      }
+      if (!on_path) {
+        queue[queue_size++] = {next, head, slot, step.depth + 1};
+      }
+    }
+  }
+  return false;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+std::pair<size_t, size_t> CuckooMap<Key, Value, Hash, Equal, Alloc>::make_slot(size_t hash) {
+  if (static_cast<float>(size_ + 1) > max_load_factor_ * static_cast<float>(buckets_.size() * SLOTS_)) {
+    rehash(2 * buckets_.size());
+  }
+  auto move = [this](size_t from_bucket, size_t from_slot, size_t to_bucket, size_t to_slot) {
+    move_slot(from_bucket, from_slot, to_bucket, to_slot);
+  };
+  for (size_t growths = 0;; ++growths) {
+    size_t first = get_bucket(hash);
+    size_t second = alternate_bucket(first, get_tag(hash), buckets_.size());
+    std::pair<size_t, size_t> result;
+    if (make_free_slot(buckets_, first, second, result, move)) {
+      return result;
+    }
+    if (growths == MAX_GROWTHS_ || shares_hash(first, second, hash)) {
+      throw std::length_error("too many keys of the cuckoo map share a hash");
+    }
+    rehash(2 * buckets_.size());
+  }
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+bool CuckooMap<Key, Value, Hash, Equal, Alloc>::shares_hash(size_t first, size_t second, size_t hash) const {
+  for (size_t bucket : {first, second}) {
+    auto& candidate = const_cast<Bucket&>(buckets_[bucket]);
+    for (size_t slot = 0; slot < SLOTS_; ++slot) {
+      if (candidate.tags[slot] == FREE_ || get_hash(candidate.slot(slot)->first) != hash) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Places every entry into a plan of the given size, moving only positions;
+// fails if some entry finds no free slot.
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+bool CuckooMap<Key, Value, Hash, Equal, Alloc>::plan_rehash(
+    std::vector<PlannedBucket>& plan, size_t bucket_count) const {
+  plan.assign(bucket_count, PlannedBucket());
+  auto move = [&plan](size_t from_bucket, size_t from_slot, size_t to_bucket, size_t to_slot) {
+    plan[to_bucket].tags[to_slot] = plan[from_bucket].tags[from_slot];
+    plan[to_bucket].sources[to_slot] = plan[from_bucket].sources[from_slot];
+    plan[from_bucket].tags[from_slot] = FREE_;
+  };
+  for (size_t i = 0; i < buckets_.size(); ++i) {
+    for (size_t slot = 0; slot < SLOTS_; ++slot) {
+      if (buckets_[i].tags[slot] == FREE_) {
+        continue;
+      }
+      size_t hash = get_hash(const_cast<Bucket&>(buckets_[i]).slot(slot)->first);
+      size_t first = hash & (bucket_count - 1);
+      std::pair<size_t, size_t> result;
+      if (!make_free_slot(plan, first, alternate_bucket(first, get_tag(hash), bucket_count), result, move)) {
+        return false;
+      }
+      plan[result.first].tags[result.second] = get_tag(hash);
+      plan[result.first].sources[result.second] = i * SLOTS_ + slot;
+    }
+  }
+  return true;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+template<typename... Args>
+typename CuckooMap<Key, Value, Hash, Equal, Alloc>::iterator
+CuckooMap<Key, Value, Hash, Equal, Alloc>::construct_at(size_t hash, Args&& ... args) {
+  auto [bucket, slot] = make_slot(hash);
+  AllocTraits::construct(allocator_, buckets_[bucket].slot(slot), std::forward<Args>(args)...);
+  buckets_[bucket].tags[slot] = get_tag(hash);
+  ++size_;
+  return make_iterator(bucket, slot);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+size_t CuckooMap<Key, Value, Hash, Equal, Alloc>::size() const noexcept {
+  return size_;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+typename CuckooMap<Key, Value, Hash, Equal, Alloc>::iterator
+CuckooMap<Key, Value, Hash, Equal, Alloc>::find(const Key& key) noexcept {
+  auto [bucket, slot] = find_slot(key, get_hash(key));
+  return make_iterator(bucket, slot);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+typename CuckooMap<Key, Value, Hash, Equal, Alloc>::const_iterator
+CuckooMap<Key, Value, Hash, Equal, Alloc>::find(const Key& key) const noexcept {
+  return const_cast<CuckooMap*>(this)->find(key);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+bool CuckooMap<Key, Value, Hash, Equal, Alloc>::contains(const Key& key) const noexcept {
+  return find_slot(key, get_hash(key)).first != buckets_.size();
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+size_t CuckooMap<Key, Value, Hash, Equal, Alloc>::count(const Key& key) const noexcept {
+  return contains(key) ? 1 : 0;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+template<typename... Args>
+std::pair<typename CuckooMap<Key, Value, Hash, Equal, Alloc>::iterator, bool>
+CuckooMap<Key, Value, Hash, Equal, Alloc>::emplace(Args&& ... args) {
+  return insert(node_type(std::forward<Args>(args)...));
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+std::pair<typename CuckooMap<Key, Value, Hash, Equal, Alloc>::iterator, bool>
+CuckooMap<Key, Value, Hash, Equal, Alloc>::insert(const node_type& kv) {
+  size_t hash = get_hash(kv.first);
+  auto [bucket, slot] = find_slot(kv.first, hash);
+  if (bucket != buckets_.size()) {
+    return {make_iterator(bucket, slot), false};
+  }
+  return {construct_at(hash, kv), true};
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+std::pair<typename CuckooMap<Key, Value, Hash, Equal, Alloc>::iterator, bool>
+CuckooMap<Key, Value, Hash, Equal, Alloc>::insert(node_type&& kv) {
+  size_t hash = get_hash(kv.first);
+  auto [bucket, slot] = find_slot(kv.first, hash);
+  if (bucket != buckets_.size()) {
+    return {make_iterator(bucket, slot), false};
+  }
+  return {construct_at(hash, std::move(kv)), true};
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+template<typename InputIterator>
+void CuckooMap<Key, Value, Hash, Equal, Alloc>::insert(
+    const InputIterator& left_bound, const InputIterator& right_bound) {
+  reserve(size() + std::distance(left_bound, right_bound));
+  for (auto it = left_bound; it != right_bound; ++it) {
+    insert(*it);
+  }
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+void CuckooMap<Key, Value, Hash, Equal, Alloc>::erase(const iterator& it) noexcept {
+  AllocTraits::destroy(allocator_, it.bucket_->slot(it.slot_));
+  it.bucket_->tags[it.slot_] = FREE_;
+  --size_;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+size_t CuckooMap<Key, Value, Hash, Equal, Alloc>::erase(const Key& key) noexcept {
+  auto it = find(key);
+  if (it == end()) {
+    return 0;
+  }
+  erase(it);
+  return 1;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+Value& CuckooMap<Key, Value, Hash, Equal, Alloc>::operator[](const Key& key) {
+  size_t hash = get_hash(key);
+  auto [bucket, slot] = find_slot(key, hash);
+  if (bucket != buckets_.size()) {
+    return buckets_[bucket].slot(slot)->second;
+  }
+  return construct_at(hash, std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple())->second;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+Value& CuckooMap<Key, Value, Hash, Equal, Alloc>::at(const Key& key) {
+  auto pos = find(key);
+  if (pos == end()) {
+    throw std::range_error("key does not exist");
+  }
+  return pos->second;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+const Value& CuckooMap<Key, Value, Hash, Equal, Alloc>::at(const Key& key) const {
+  return const_cast<CuckooMap*>(this)->at(key);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+void CuckooMap<Key, Value, Hash, Equal, Alloc>::reserve(size_t count) {
+  size_t bucket_count = std::max(buckets_.size(), size_t(1));
+  while (static_cast<float>(count) > max_load_factor_ * static_cast<float>(bucket_count * SLOTS_)) {
+    bucket_count *= 2;
+  }
+  if (bucket_count != buckets_.size()) {
+    rehash(bucket_count);
+  }
+}
+
+// Plans the new table first, growing it until every entry has a slot, then
+// moves the entries, or copies them if their move may throw. If that throws,
+// the new table is dropped and the map is left as it was.
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+void CuckooMap<Key, Value, Hash, Equal, Alloc>::rehash(size_t bucket_count) {
+  bucket_count = PowerOfTwoBucketPolicy().bucket_count(std::max({bucket_count, size_t(2),
+      static_cast<size_t>(std::ceil(size_ / max_load_factor_ / SLOTS_))}));
+  std::vector<PlannedBucket> plan;
+  for (size_t growths = 0; !plan_rehash(plan, bucket_count); ++growths, bucket_count *= 2) {
+    if (growths == MAX_GROWTHS_) {
+      throw std::length_error("too many keys of the cuckoo map share a hash");
+    }
+  }
+
+  std::vector<Bucket, BucketAlloc> buckets(bucket_count, BucketAlloc(allocator_));
+  auto destroy_new = [this, &buckets]() noexcept {
+    for (auto& bucket : buckets) {
+      for (size_t slot = 0; slot < SLOTS_; ++slot) {
+        if (bucket.tags[slot] != FREE_) {
+          AllocTraits::destroy(allocator_, bucket.slot(slot));
+        }
+      }
+    }
+  };
+  try {
+    for (size_t i = 0; i < plan.size(); ++i) {
+      for (size_t slot = 0; slot < SLOTS_; ++slot) {
+        if (plan[i].tags[slot] == FREE_) {
+          continue;
+        }
+        size_t source = plan[i].sources[slot];
+        AllocTraits::construct(allocator_, buckets[i].slot(slot),
+                               std::move_if_noexcept(*buckets_[source / SLOTS_].slot(source % SLOTS_)));
+        buckets[i].tags[slot] = plan[i].tags[slot];
+      }
+    }
+  } catch (...) {
+    destroy_new();
+    throw;
+  }
+  size_t size = size_;
+  destroy_elements();
+  buckets_.swap(buckets);
+  size_ = size;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+size_t CuckooMap<Key, Value, Hash, Equal, Alloc>::max_size() const noexcept {
+  return AllocTraits::max_size(allocator_);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+float CuckooMap<Key, Value, Hash, Equal, Alloc>::max_load_factor() const noexcept {
+  return max_load_factor_;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+void CuckooMap<Key, Value, Hash, Equal, Alloc>::max_load_factor(float value) {
+  if (!(value > 0 && value <= 1)) {
+    throw std::invalid_argument("cuckoo map load factor must be in (0, 1]");
+  }
+  max_load_factor_ = value;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+float CuckooMap<Key, Value, Hash, Equal, Alloc>::load_factor() const noexcept {
+  return buckets_.empty() ? 0 : static_cast<float>(size_) / static_cast<float>(buckets_.size() * SLOTS_);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+size_t CuckooMap<Key, Value, Hash, Equal, Alloc>::bucket_count() const noexcept {
+  return buckets_.size();
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+typename CuckooMap<Key, Value, Hash, Equal, Alloc>::iterator
+CuckooMap<Key, Value, Hash, Equal, Alloc>::begin() noexcept {
+  iterator result(buckets_.data(), buckets_.data() + buckets_.size(), 0);
+  result.skip_free();
+  return result;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+typename CuckooMap<Key, Value, Hash, Equal, Alloc>::const_iterator
+CuckooMap<Key, Value, Hash, Equal, Alloc>::begin() const noexcept {
+  return const_cast<CuckooMap*>(this)->begin();
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+typename CuckooMap<Key, Value, Hash, Equal, Alloc>::const_iterator
+CuckooMap<Key, Value, Hash, Equal, Alloc>::cbegin() const noexcept {
+  return begin();
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+typename CuckooMap<Key, Value, Hash, Equal, Alloc>::iterator
+CuckooMap<Key, Value, Hash, Equal, Alloc>::end() noexcept {
+  return iterator(buckets_.data() + buckets_.size(), buckets_.data() + buckets_.size(), 0);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+typename CuckooMap<Key, Value, Hash, Equal, Alloc>::const_iterator
+CuckooMap<Key, Value, Hash, Equal, Alloc>::end() const noexcept {
+  return const_cast<CuckooMap*>(this)->end();
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+typename CuckooMap<Key, Value, Hash, Equal, Alloc>::const_iterator
+CuckooMap<Key, Value, Hash, Equal, Alloc>::cend() const noexcept {
+  return end();
+}
+
+#endif //UNORDERED_MAP__CUCKOO_MAP_H_
@@ -0,0 +1,152 @@
+#include "cuckoo_map.h"
+
+#include <cassert>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+void TestBasics() {
+    CuckooMap<std::string, int> m;
+    assert(m.insert({"a", 1}).second);
+    assert(!m.insert({"a", 2}).second);
+    assert(m.emplace("b", 2).second);
+    m["c"] = 3;
+    assert(m.size() == 3 && m.at("a") == 1 && m["b"] == 2);
+    assert(m.contains("c") && m.count("d") == 0 && m.find("d") == m.end());
+
+    bool thrown = false;
+    try {
+        m.at("d");
+    } catch (const std::range_error&) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    assert(m.erase("b") == 1 && m.erase("b") == 0);
+    m.erase(m.find("a"));
+    assert(m.size() == 1 && m.begin()->first == "c" && ++m.begin() == m.end());
+
+    CuckooMap<std::string, int> copy = m;
+    copy["d"] = 4;
+    CuckooMap<std::string, int> moved = std::move(copy);
+    assert(moved.size() == 2 && m.size() == 1 && moved.at("c") == 3);
+    assert(copy.size() == 0 && copy.begin() == copy.end() && copy.load_factor() == 0);
+    assert(!copy.contains("c") && copy.find("d") == copy.end() && copy.erase("c") == 0);
+    copy["a"] = 1;
+    assert(copy.size() == 1 && copy.at("a") == 1);
+    CuckooMap<std::string, int> reserved = std::move(copy);
+    copy.reserve(100);
+    copy.emplace("b", 2);
+    assert(copy.size() == 1 && copy.at("b") == 2 && reserved.at("a") == 1);
+    m = moved;
+    assert(m.size() == 2 && m.at("d") == 4);
+}
+
+// Random inserts and erases against UnorderedMap at the highest load factor.
+void TestHighLoad() {
+    CuckooMap<int, int> m;
+    m.max_load_factor(1.0);
+    UnorderedMap<int, int> reference;
+    std::mt19937 gen(7);
+    for (int i = 0; i < 200'000; ++i) {
+        int key = static_cast<int>(gen() % 50'000);
+        if (gen() % 4 == 0) {
+            assert(m.erase(key) == reference.erase(key));
+        } else {
+            assert(m.emplace(key, i).second == reference.emplace(key, i).second);
+        }
+    }
+    assert(m.size() == reference.size());
+    assert(m.load_factor() > 0.5);
+    size_t count = 0;
+    for (const auto& kv : m) {
+        assert(reference.at(kv.first) == kv.second);
+        ++count;
+    }
+    assert(count == m.size());
+    for (int key = 0; key < 50'000; ++key) {
+        assert(m.contains(key) == reference.contains(key));
+    }
+
+    CuckooMap<int, int> dense;
+    dense.max_load_factor(0.95);
+    dense.reserve(100'000);
+    size_t buckets = dense.bucket_count();
+    for (int i = 0; i < 100'000; ++i) {
+        dense[i * 3] = i;
+    }
+    assert(dense.bucket_count() == buckets && dense.load_factor() > 0.75);
+    for (int i = 0; i < 100'000; ++i) {
+        assert(dense.at(i * 3) == i && !dense.contains(i * 3 + 1));
+    }
+}
+
+struct ConstantHash {
+    size_t operator()(int) const noexcept {
+        return 42;
+    }
+};
+
+struct ThrowingCopy {
+    static inline int copies_left = -1;
+    int value;
+
+    explicit ThrowingCopy(int value) : value(value) {}
+    ThrowingCopy(const ThrowingCopy& other) : value(other.value) {
+        if (copies_left >= 0 && copies_left-- == 0) {
+            throw std::runtime_error("copy");
+        }
+    }
+};
+
+void TestFailures() {
+    // Keys with one hash share both buckets at every size: the table must not
+    // keep doubling for them.
+    CuckooMap<int, int, ConstantHash> same;
+    size_t fitting = 0;
+    bool thrown = false;
+    try {
+        for (int i = 0; i < 100; ++i) {
+            same.emplace(i, i);
+            ++fitting;
+        }
+    } catch (const std::length_error&) {
+        thrown = true;
+    }
+    assert(thrown && fitting == 8 && same.size() == 8 && same.bucket_count() <= 64);
+    for (int i = 0; i < 8; ++i) {
+        assert(same.at(i) == i);
+    }
+
+    // A copy that throws while rehashing leaves the map as it was.
+    CuckooMap<int, ThrowingCopy> m;
+    for (int i = 0; i < 1000; ++i) {
+        m.emplace(i, i);
+    }
+    size_t buckets = m.bucket_count();
+    ThrowingCopy::copies_left = 500;
+    thrown = false;
+    try {
+        m.rehash(4 * buckets);
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    ThrowingCopy::copies_left = -1;
+    assert(thrown && m.size() == 1000 && m.bucket_count() == buckets);
+    for (int i = 0; i < 1000; ++i) {
+        assert(m.at(i).value == i);
+    }
+    m.rehash(4 * buckets);
+    assert(m.bucket_count() == 4 * buckets && m.at(999).value == 999);
+}
+
+int main() {
+    std::cerr << "Starting tests" << std::endl;
+    TestBasics();
+    std::cerr << "TestBasics (1 of 3) passed" << std::endl;
+    TestHighLoad();
+    std::cerr << "TestHighLoad (2 of 3) passed" << std::endl;
+    TestFailures();
+    std::cerr << "TestFailures (3 of 3) passed" << std::endl;
+    std::cout << 0;
+}
@@ -0,0 +1,680 @@
+#ifndef UNORDERED_MAP__DENSE_MAP_H_
+#define UNORDERED_MAP__DENSE_MAP_H_
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "unordered_map.h"
+
+// An insertion-ordered map laid out like a Python dict: the entries sit in
+// one array in the order they were inserted, and a separate open-addressing
+// table holds only their positions, in 1, 2, 4 or 8 bytes each depending on
+// how many entries the array can hold. Iteration is a scan of the array.
+// Erasing leaves a hole, so the order of the remaining entries is kept; the
+// holes are squeezed out when the array is next rebuilt. Inserting may
+// rebuild it and invalidates iterators; erasing does not.
+template<typename Key, typename Value, typename Hash = std::hash<Key>,
+    typename Equal = std::equal_to<Key>,
+    typename Alloc = std::allocator<std::pair<const Key, Value>>>
+class DenseMap {
+ private:
+  template<bool is_const>
+  class CommonIterator;
+
+ public:
+  using AllocTraits = std::allocator_traits<Alloc>;
+  using node_type = std::pair<const Key, Value>;
+  using iterator = CommonIterator<false>;
+  using const_iterator = CommonIterator<true>;
+
+ private:
+  static const size_t MIN_INDEX_COUNT_ = 8;
+  static const size_t ERASED_ = 0;
+  static const size_t NONE_ = static_cast<size_t>(-1);
+
+  struct Entry {
+    // The mixed hash of the key, or ERASED_ once the entry is gone.
+    size_t hash;
+    alignas(node_type) unsigned char storage[sizeof(node_type)];
+
+    // Leaves the storage uninitialized; only entries below used_ are read.
+    Entry() noexcept {}
+    node_type* value() noexcept;
+  };
+
+  using EntryAlloc = typename AllocTraits::template rebind_alloc<Entry>;
+  using IndexAlloc = typename AllocTraits::template rebind_alloc<unsigned char>;
+
+  Alloc allocator_ = Alloc();
+  std::vector<Entry, EntryAlloc> entries_ = std::vector<Entry, EntryAlloc>(allocator_);
+  // index_count slots of width_ bytes; a slot holds an entry position plus
+  // one, 0 marks a free slot. Slots of erased entries stay taken.
+  std::vector<unsigned char, IndexAlloc> indices_ = std::vector<unsigned char, IndexAlloc>(allocator_);
+  size_t used_ = 0;
+  size_t size_ = 0;
+  size_t width_ = 1;
+  size_t mask_ = 0;
+  Equal key_equal_ = Equal();
+  Hash hasher_ = Hash();
+
+  // The table is at most two thirds full, so this many entries fit.
+  static size_t usable(size_t) noexcept;
+  static size_t index_width(size_t) noexcept;
+  static size_t index_count_for(size_t) noexcept;
+
+  size_t get_hash(const Key&) const noexcept;
+  size_t get_index(size_t) const noexcept;
+  void set_index(size_t, size_t) noexcept;
+  size_t find_entry(const Key&, size_t) const noexcept;
+  // Adds entries_[used_], already constructed, under the given hash.
+  iterator commit(size_t) noexcept;
+  // Moves the entries in order into arrays for the given index count.
+  void rebuild(size_t);
+  void make_room();
+  iterator make_iterator(size_t) noexcept;
+  void destroy_elements() noexcept;
+
+ public:
+  DenseMap();
+  DenseMap(size_t, const Hash& hasher = Hash(), const Equal& key_equal = Equal(),
+           const Alloc& alloc = Alloc());
+  DenseMap(const DenseMap&);
+  DenseMap& operator=(const DenseMap&);
+  DenseMap(DenseMap&&) noexcept;
+  DenseMap& operator=(DenseMap&&) noexcept;
+  ~DenseMap() noexcept;
+
+  size_t size() const noexcept;
+
+  iterator find(const Key&) noexcept;
+  const_iterator find(const Key&) const noexcept;
+  bool contains(const Key&) const noexcept;
+  size_t count(const Key&) const noexcept;
+
+  template<typename... Args>
+  std::pair<iterator, bool> emplace(Args&& ...);
+  std::pair<iterator, bool> insert(const node_type&);
+  std::pair<iterator, bool> insert(node_type&&);
+  template<typename InputIterator>
+  void insert(const InputIterator&, const InputIterator&);
+
+  void erase(const iterator&) noexcept;
+  size_t erase(const Key&) noexcept;
+
+  Value& operator[](const Key&);
+  Value& at(const Key&);
+  const Value& at(const Key&) const;
+
+  // Makes room for the given number of entries without another rebuild.
+  void reserve(size_t);
+  // Squeezes out erased entries and shrinks both arrays to fit.
+  void shrink_to_fit();
+  size_t max_size() const noexcept;
+  // Entries the array holds before the next rebuild, erased ones included.
+  size_t capacity() const noexcept;
+  size_t bucket_count() const noexcept;
+
+  iterator begin() noexcept;
+  const_iterator begin() const noexcept;
+  const_iterator cbegin() const noexcept;
+  iterator end() noexcept;
+  const_iterator end() const noexcept;
+  const_iterator cend() const noexcept;
+};
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+template<bool is_const>
+class DenseMap<Key, Value, Hash, Equal, Alloc>::CommonIterator {
+ private:
+  using EntryPointer = typename std::conditional<is_const, const Entry*, Entry*>::type;
+
+  EntryPointer entry_ = nullptr;
+  EntryPointer end_ = nullptr;
+
+  void skip_erased() noexcept;
+
+  friend class DenseMap;
+
+ public:
+  CommonIterator() noexcept = default;
+  CommonIterator(EntryPointer, EntryPointer) noexcept;
+
+  using value_type = node_type;
+  using iterator_category = std::forward_iterator_tag;
+  using difference_type = ssize_t;
+  using reference = typename std::conditional<is_const, const node_type&, node_type&>::type;
+  using pointer = typename std::conditional<is_const, const node_type*, node_type*>::type;
+
+  operator CommonIterator<true>() const noexcept;
+
+  CommonIterator<is_const>& operator++() noexcept;
+  CommonIterator<is_const> operator++(int) noexcept;
+
+  reference operator*() const noexcept;
+  pointer operator->() const noexcept;
+
+  bool operator==(const CommonIterator<is_const>&) const noexcept;
+  bool operator!=(const CommonIterator<is_const>&) const noexcept;
+};
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+typename DenseMap<Key, Value, Hash, Equal, Alloc>::node_type*
+DenseMap<Key, Value, Hash, Equal, Alloc>::Entry::value() noexcept {
+  return reinterpret_cast<node_type*>(storage);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+template<bool is_const>
+DenseMap<Key, Value, Hash, Equal, Alloc>::CommonIterator<is_const>::CommonIterator(
+    EntryPointer entry, EntryPointer end) noexcept : entry_(entry), end_(end) {}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+template<bool is_const>
+void DenseMap<Key, Value, Hash, Equal, Alloc>::CommonIterator<is_const>::skip_erased() noexcept {
+  while (entry_ != end_ && entry_->hash == ERASED_) {
+    ++entry_;
+  }
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+template<bool is_const>
+DenseMap<Key, Value, Hash, Equal, Alloc>::CommonIterator<is_const>::operator CommonIterator<true>() const noexcept {
+  return CommonIterator<true>(entry_, end_);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+template<bool is_const>
+typename DenseMap<Key, Value, Hash, Equal, Alloc>::template CommonIterator<is_const>&
+DenseMap<Key, Value, Hash, Equal, Alloc>::CommonIterator<is_const>::operator++() noexcept {
+  ++entry_;
+  skip_erased();
+  return *this;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+template<bool is_const>
+typename DenseMap<Key, Value, Hash, Equal, Alloc>::template CommonIterator<is_const>
+DenseMap<Key, Value, Hash, Equal, Alloc>::CommonIterator<is_const>::operator++(int) noexcept {
+  CommonIterator<is_const> tmp(*this);
+  ++(*this);
+  return tmp;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+template<bool is_const>
+typename DenseMap<Key, Value, Hash, Equal, Alloc>::template CommonIterator<is_const>::reference
+DenseMap<Key, Value, Hash, Equal, Alloc>::CommonIterator<is_const>::operator*() const noexcept {
+  return *operator->();
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+template<bool is_const>
+typename DenseMap<Key, Value, Hash, Equal, Alloc>::template CommonIterator<is_const>::pointer
+DenseMap<Key, Value, Hash, Equal, Alloc>::CommonIterator<is_const>::operator->() const noexcept {
+  return const_cast<Entry*>(entry_)->value();
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+template<bool is_const>
+bool DenseMap<Key, Value, Hash, Equal, Alloc>::CommonIterator<is_const>::operator==(
+    const CommonIterator<is_const>& other) const noexcept {
+  return entry_ == other.entry_;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+template<bool is_const>
+bool DenseMap<Key, Value, Hash, Equal, Alloc>::CommonIterator<is_const>::operator!=(
+    const CommonIterator<is_const>& other) const noexcept {
+  return !(*this == other);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+DenseMap<Key, Value, Hash, Equal, Alloc>::DenseMap() = default;
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+DenseMap<Key, Value, Hash, Equal, Alloc>::DenseMap(
+    size_t count, const Hash& hasher, const Equal& key_equal, const Alloc& alloc) :
+    allocator_(alloc), entries_(EntryAlloc(alloc)), indices_(IndexAlloc(alloc)),
+    key_equal_(key_equal), hasher_(hasher) {
+  if (count > 0) {
+    reserve(count);
+  }
+}
+
+// Positions are unchanged, so the index table is copied as it is.
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+DenseMap<Key, Value, Hash, Equal, Alloc>::DenseMap(const DenseMap& other) :
+    DenseMap(0, other.hasher_, other.key_equal_,
+             AllocTraits::select_on_container_copy_construction(other.allocator_)) {
+  std::vector<Entry, EntryAlloc> entries(other.entries_.size(), EntryAlloc(allocator_));
+  entries_.swap(entries);
+  indices_.assign(other.indices_.begin(), other.indices_.end());
+  width_ = other.width_;
+  mask_ = other.mask_;
+  try {
+    for (; used_ < other.used_; ++used_) {
+      auto& from = const_cast<Entry&>(other.entries_[used_]);
+      if (from.hash != ERASED_) {
+        AllocTraits::construct(allocator_, entries_[used_].value(), *from.value());
+        ++size_;
+      }
+      entries_[used_].hash = from.hash;
+    }
+  } catch (...) {
+    destroy_elements();
+    throw;
+  }
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+DenseMap<Key, Value, Hash, Equal, Alloc>&
+DenseMap<Key, Value, Hash, Equal, Alloc>::operator=(const DenseMap& other) {
+  if (this != &other) {
+    DenseMap tmp(other);
+    *this = std::move(tmp);
+  }
+  return *this;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+DenseMap<Key, Value, Hash, Equal, Alloc>::DenseMap(DenseMap&& other) noexcept :
+    allocator_(std::move(other.allocator_)), entries_(std::move(other.entries_)),
+    indices_(std::move(other.indices_)), used_(other.used_), size_(other.size_), width_(other.width_),
+    mask_(other.mask_), key_equal_(std::move(other.key_equal_)), hasher_(std::move(other.hasher_)) {
+  other.entries_.clear();
+  other.indices_.clear();
+  other.used_ = 0;
+  other.size_ = 0;
+  other.mask_ = 0;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+DenseMap<Key, Value, Hash, Equal, Alloc>&
+DenseMap<Key, Value, Hash, Equal, Alloc>::operator=(DenseMap&& other) noexcept {
+  if (this != &other) {
+    destroy_elements();
+    allocator_ = std::move(other.allocator_);
+    entries_ = std::move(other.entries_);
+    indices_ = std::move(other.indices_);
+    used_ = other.used_;
+    size_ = other.size_;
+    width_ = other.width_;
+    mask_ = other.mask_;
+    key_equal_ = std::move(other.key_equal_);
+    hasher_ = std::move(other.hasher_);
+    other.entries_.clear();
+    other.indices_.clear();
+    other.used_ = 0;
+    other.size_ = 0;
+    other.mask_ = 0;
+  }
+  return *this;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+DenseMap<Key, Value, Hash, Equal, Alloc>::~DenseMap() noexcept {
+  destroy_elements();
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+void DenseMap<Key, Value, Hash, Equal, Alloc>::destroy_elements() noexcept {
+  for (size_t i = 0; i < used_; ++i) {
+    if (entries_[i].hash != ERASED_) {
+      AllocTraits::destroy(allocator_, entries_[i].value());
+      entries_[i].hash = ERASED_;
+    }
+  }
+  size_ = 0;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+size_t DenseMap<Key, Value, Hash, Equal, Alloc>::usable(size_t index_count) noexcept {
+  return index_count * 2 / 3;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+size_t DenseMap<Key, Value, Hash, Equal, Alloc>::index_width(size_t index_count) noexcept {
+  size_t count = usable(index_count);
+  return count <= UINT8_MAX ? 1 : count <= UINT16_MAX ? 2 : count <= UINT32_MAX ? 4 : 8;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+size_t DenseMap<Key, Value, Hash, Equal, Alloc>::index_count_for(size_t count) noexcept {
+  size_t index_count = MIN_INDEX_COUNT_;
+  while (usable(index_count) < count) {
+    index_count *= 2;
+  }
+  return index_count;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+size_t DenseMap<Key, Value, Hash, Equal, Alloc>::get_hash(const Key& key) const noexcept {
+  size_t hash = mix_hash(hasher_(key));
+  return hash == ERASED_ ? 1 : hash;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+size_t DenseMap<Key, Value, Hash, Equal, Alloc>::get_index(size_t slot) const noexcept {
+  const unsigned char* bytes = indices_.data() + slot * width_;
+  switch (width_) {
+    case 1:
+      return *bytes;
+    case 2: {
+      uint16_t index;
+      std::memcpy(&index, bytes, sizeof(index));
+      return index;
+    }
+    case 4: {
+      uint32_t index;
+      std::memcpy(&index, bytes, sizeof(index));
+      return index;
+    }
+    default: {
+      uint64_t index;
+      std::memcpy(&index, bytes, sizeof(index));
+      return index;
+    }
+  }
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+void DenseMap<Key, Value, Hash, Equal, Alloc>::set_index(size_t slot, size_t index) noexcept {
+  unsigned char* bytes = indices_.data() + slot * width_;
+  switch (width_) {
+    case 1:
+      *bytes = static_cast<uint8_t>(index);
+      break;
+    case 2: {
+      auto value = static_cast<uint16_t>(index);
+      std::memcpy(bytes, &value, sizeof(value));
+      break;
+    }
+    case 4: {
+      auto value = static_cast<uint32_t>(index);
+      std::memcpy(bytes, &value, sizeof(value));
+      break;
+    }
+    default: {
+      auto value = static_cast<uint64_t>(index);
+      std::memcpy(bytes, &value, sizeof(value));
+      break;
+    }
+  }
+}
+
+// Linear probing; slots of erased entries never match and are probed past.
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+size_t DenseMap<Key, Value, Hash, Equal, Alloc>::find_entry(const Key& key, size_t hash) const noexcept {
+  if (size_ == 0) {
+    return NONE_;
+  }
+  for (size_t slot = hash & mask_;; slot = (slot + 1) & mask_) {
+    size_t index = get_index(slot);
+    if (index == 0) {
+      return NONE_;
+    }
+    auto& entry = const_cast<Entry&>(entries_[index - 1]);
+    if (entry.hash == hash && key_equal_(entry.value()->first, key)) {
+      return index - 1;
+    }
+  }
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+typename DenseMap<Key, Value, Hash, Equal, Alloc>::iterator
+DenseMap<Key, Value, Hash, Equal, Alloc>::commit(size_t hash) noexcept {
+  entries_[used_].hash = hash;
+  size_t slot = hash & mask_;
+  while (get_index(slot) != 0) {
+    slot = (slot + 1) & mask_;
+  }
+  set_index(slot, used_ + 1);
+  ++size_;
+  return make_iterator(used_++);
+}
+
+// The old arrays stay intact until every entry has been constructed in the
+// new ones: entries are copied unless moving them cannot throw, so a failed
+// rebuild leaves the map as it was.
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+void DenseMap<Key, Value, Hash, Equal, Alloc>::rebuild(size_t index_count) {
+  std::vector<Entry, EntryAlloc> entries(usable(index_count), EntryAlloc(allocator_));
+  std::vector<unsigned char, IndexAlloc> indices(index_count * index_width(index_count), 0,
+                                                 IndexAlloc(allocator_));
+  size_t count = 0;
+  try {
+    for (size_t i = 0; i < used_; ++i) {
+      if (entries_[i].hash == ERASED_) {
+        continue;
+      }
+      AllocTraits::construct(allocator_, entries[count].value(), std::move_if_noexcept(*entries_[i].value()));
+      entries[count++].hash = entries_[i].hash;
+    }
+  } catch (...) {
+    for (size_t i = 0; i < count; ++i) {
+      AllocTraits::destroy(allocator_, entries[i].value());
+    }
+    throw;
+  }
+  destroy_elements();
+  entries.swap(entries_);
+  indices_.swap(indices);
+  width_ = index_width(index_count);
+  mask_ = index_count - 1;
+  used_ = 0;
+  for (size_t i = 0; i < count; ++i) {
+    commit(entries_[i].hash);
+  }
+}
+
+// Holes are squeezed out first; the arrays grow only if the live entries
+// would fill more than half of them.
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+void DenseMap<Key, Value, Hash, Equal, Alloc>::make_room() {
+  rebuild(index_count_for(std::max(2 * size_, size_t(1))));
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+typename DenseMap<Key, Value, Hash, Equal, Alloc>::iterator
+DenseMap<Key, Value, Hash, Equal, Alloc>::make_iterator(size_t index) noexcept {
+  return iterator(entries_.data() + index, entries_.data() + used_);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+size_t DenseMap<Key, Value, Hash, Equal, Alloc>::size() const noexcept {
+  return size_;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+typename DenseMap<Key, Value, Hash, Equal, Alloc>::iterator
+DenseMap<Key, Value, Hash, Equal, Alloc>::find(const Key& key) noexcept {
+  size_t index = find_entry(key, get_hash(key));
+  return index == NONE_ ? end() : make_iterator(index);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+typename DenseMap<Key, Value, Hash, Equal, Alloc>::const_iterator
+DenseMap<Key, Value, Hash, Equal, Alloc>::find(const Key& key) const noexcept {
+  return const_cast<DenseMap*>(this)->find(key);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+bool DenseMap<Key, Value, Hash, Equal, Alloc>::contains(const Key& key) const noexcept {
+  return find_entry(key, get_hash(key)) != NONE_;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+size_t DenseMap<Key, Value, Hash, Equal, Alloc>::count(const Key& key) const noexcept {
+  return contains(key) ? 1 : 0;
+}
+
+// The entry is built in place at the end of the array and dropped again if
+// its key is already there.
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+template<typename... Args>
+std::pair<typename DenseMap<Key, Value, Hash, Equal, Alloc>::iterator, bool>
+DenseMap<Key, Value, Hash, Equal, Alloc>::emplace(Args&& ... args) {
+  if (used_ == entries_.size()) {
+    make_room();
+  }
+  node_type* node = entries_[used_].value();
+  AllocTraits::construct(allocator_, node, std::forward<Args>(args)...);
+  size_t hash = get_hash(node->first);
+  size_t index = find_entry(node->first, hash);
+  if (index != NONE_) {
+    AllocTraits::destroy(allocator_, node);
+    return {make_iterator(index), false};
+  }
+  return {commit(hash), true};
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+std::pair<typename DenseMap<Key, Value, Hash, Equal, Alloc>::iterator, bool>
+DenseMap<Key, Value, Hash, Equal, Alloc>::insert(const node_type& kv) {
+  return emplace(kv);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+std::pair<typename DenseMap<Key, Value, Hash, Equal, Alloc>::iterator, bool>
+DenseMap<Key, Value, Hash, Equal, Alloc>::insert(node_type&& kv) {
+  return emplace(std::move(kv));
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+template<typename InputIterator>
+void DenseMap<Key, Value, Hash, Equal, Alloc>::insert(
+    const InputIterator& left_bound, const InputIterator& right_bound) {
+  reserve(size() + std::distance(left_bound, right_bound));
+  for (auto it = left_bound; it != right_bound; ++it) {
+    insert(*it);
+  }
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+void DenseMap<Key, Value, Hash, Equal, Alloc>::erase(const iterator& it) noexcept {
+  AllocTraits::destroy(allocator_, it.entry_->value());
+  it.entry_->hash = ERASED_;
+  --size_;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+size_t DenseMap<Key, Value, Hash, Equal, Alloc>::erase(const Key& key) noexcept {
+  auto it = find(key);
+  if (it == end()) {
+    return 0;
+  }
+  erase(it);
+  return 1;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+Value& DenseMap<Key, Value, Hash, Equal, Alloc>::operator[](const Key& key) {
+  size_t hash = get_hash(key);
+  size_t index = find_entry(key, hash);
+  if (index != NONE_) {
+    return entries_[index].value()->second;
+  }
+  if (used_ == entries_.size()) {
+    make_room();
+  }
+  AllocTraits::construct(allocator_, entries_[used_].value(), std::piecewise_construct,
+                         std::forward_as_tuple(key), std::forward_as_tuple());
+  return commit(hash)->second;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+Value& DenseMap<Key, Value, Hash, Equal, Alloc>::at(const Key& key) {
+  auto pos = find(key);
+  if (pos == end()) {
+    throw std::range_error("key does not exist");
+  }
+  return pos->second;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+const Value& DenseMap<Key, Value, Hash, Equal, Alloc>::at(const Key& key) const {
+  return const_cast<DenseMap*>(this)->at(key);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+void DenseMap<Key, Value, Hash, Equal, Alloc>::reserve(size_t count) {
+  if (count > entries_.size() - (used_ - size_)) {
+    rebuild(index_count_for(count));
+  }
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+void DenseMap<Key, Value, Hash, Equal, Alloc>::shrink_to_fit() {
+  if (size_ == 0) {
+    destroy_elements();
+    std::vector<Entry, EntryAlloc>(allocator_).swap(entries_);
+    std::vector<unsigned char, IndexAlloc>(allocator_).swap(indices_);
+    used_ = 0;
+    mask_ = 0;
+    return;
+  }
+  size_t index_count = index_count_for(size_);
+  if (used_ != size_ || index_count != indices_.size() / width_) {
+    rebuild(index_count);
+  }
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+size_t DenseMap<Key, Value, Hash, Equal, Alloc>::max_size() const noexcept {
+  return AllocTraits::max_size(allocator_);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+size_t DenseMap<Key, Value, Hash, Equal, Alloc>::capacity() const noexcept {
+  return entries_.size();
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+size_t DenseMap<Key, Value, Hash, Equal, Alloc>::bucket_count() const noexcept {
+  return indices_.size() / width_;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+typename DenseMap<Key, Value, Hash, Equal, Alloc>::iterator
+DenseMap<Key, Value, Hash, Equal, Alloc>::begin() noexcept {
+  iterator it(entries_.data(), entries_.data() + used_);
+  it.skip_erased();
+  return it;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+typename DenseMap<Key, Value, Hash, Equal, Alloc>::const_iterator
+DenseMap<Key, Value, Hash, Equal, Alloc>::begin() const noexcept {
+  return const_cast<DenseMap*>(this)->begin();
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+typename DenseMap<Key, Value, Hash, Equal, Alloc>::const_iterator
+DenseMap<Key, Value, Hash, Equal, Alloc>::cbegin() const noexcept {
+  return begin();
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+typename DenseMap<Key, Value, Hash, Equal, Alloc>::iterator
+DenseMap<Key, Value, Hash, Equal, Alloc>::end() noexcept {
+  return iterator(entries_.data() + used_, entries_.data() + used_);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+typename DenseMap<Key, Value, Hash, Equal, Alloc>::const_iterator
+DenseMap<Key, Value, Hash, Equal, Alloc>::end() const noexcept {
+  return const_cast<DenseMap*>(this)->end();
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+typename DenseMap<Key, Value, Hash, Equal, Alloc>::const_iterator
+DenseMap<Key, Value, Hash, Equal, Alloc>::cend() const noexcept {
+  return end();
+}
+
+#endif //UNORDERED_MAP__DENSE_MAP_H_
@@ -0,0 +1,142 @@
+#include "dense_map.h"
+
+#include <cassert>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+void TestOrder() {
+    DenseMap<std::string, int> m;
+    for (int i = 9; i >= 0; --i) {
+        assert(m.emplace(std::to_string(i), i).second);
+    }
+    assert(!m.insert({"3", 0}).second && m.at("3") == 3);
+    m["x"] = 10;
+    assert(m.size() == 11 && m.contains("x") && m.count("y") == 0 && m.find("y") == m.end());
+
+    bool thrown = false;
+    try {
+        m.at("y");
+    } catch (const std::range_error&) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    // Erasing keeps the order of the rest, and a re-inserted key goes last.
+    assert(m.erase("5") == 1 && m.erase("5") == 0);
+    m.erase(m.find("9"));
+    m["5"] = 5;
+    std::vector<std::string> keys;
+    for (const auto& kv : m) {
+        keys.push_back(kv.first);
+    }
+    assert((keys == std::vector<std::string>{"8", "7", "6", "4", "3", "2", "1", "0", "x", "5"}));
+
+    DenseMap<std::string, int> copy = m;
+    copy.shrink_to_fit();
+    assert(copy.size() == 10 && copy.capacity() <= m.capacity());
+    DenseMap<std::string, int> moved = std::move(copy);
+    assert(copy.size() == 0 && copy.begin() == copy.end());
+    copy["a"] = 1;
+    assert(copy.size() == 1 && copy.at("a") == 1);
+    keys.clear();
+    for (const auto& kv : moved) {
+        keys.push_back(kv.first);
+    }
+    assert((keys == std::vector<std::string>{"8", "7", "6", "4", "3", "2", "1", "0", "x", "5"}));
+    m = moved;
+    assert(m.size() == 10 && m.at("x") == 10 && m.begin()->first == "8");
+}
+
+// Random inserts and erases against UnorderedMap across every index width.
+void TestAgainstUnorderedMap() {
+    DenseMap<int, int> m;
+    UnorderedMap<int, int> reference;
+    std::mt19937 gen(11);
+    for (int i = 0; i < 300'000; ++i) {
+        int key = static_cast<int>(gen() % 100'000);
+        if (gen() % 3 == 0) {
+            assert(m.erase(key) == reference.erase(key));
+        } else {
+            assert(m.emplace(key, i).second == reference.emplace(key, i).second);
+        }
+    }
+    assert(m.size() == reference.size());
+    assert(m.bucket_count() > 65'536);
+    // Values are insertion times, so insertion order means increasing values.
+    int last = -1;
+    size_t count = 0;
+    for (const auto& kv : m) {
+        assert(kv.second > last && reference.at(kv.first) == kv.second);
+        last = kv.second;
+        ++count;
+    }
+    assert(count == m.size());
+    for (int key = 0; key < 100'000; ++key) {
+        assert(m.contains(key) == reference.contains(key));
+    }
+
+    DenseMap<int, int> reserved;
+    reserved.reserve(1000);
+    size_t capacity = reserved.capacity();
+    for (int i = 0; i < 1000; ++i) {
+        reserved[i] = i;
+    }
+    assert(reserved.capacity() == capacity && reserved.at(999) == 999);
+    for (int i = 0; i < 1000; ++i) {
+        reserved.erase(i);
+    }
+    reserved.shrink_to_fit();
+    assert(reserved.capacity() == 0 && reserved.begin() == reserved.end());
+}
+
+struct ThrowingCopy {
+    static inline int copies_left = -1;
+    int value;
+
+    explicit ThrowingCopy(int value) : value(value) {}
+    ThrowingCopy(const ThrowingCopy& other) : value(other.value) {
+        if (copies_left >= 0 && copies_left-- == 0) {
+            throw std::runtime_error("copy");
+        }
+    }
+};
+
+// A rebuild that throws halfway leaves every entry, in order, where it was.
+void TestFailedRebuild() {
+    DenseMap<int, ThrowingCopy> m;
+    for (int i = 0; i < 1000; ++i) {
+        m.emplace(i, i);
+    }
+    m.erase(7);
+    size_t capacity = m.capacity();
+    ThrowingCopy::copies_left = 500;
+    bool thrown = false;
+    try {
+        m.reserve(4 * capacity);
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    ThrowingCopy::copies_left = -1;
+    assert(thrown && m.size() == 999 && m.capacity() == capacity);
+    int expected = 0;
+    for (const auto& kv : m) {
+        expected += expected == 7 ? 1 : 0;
+        assert(kv.first == expected && kv.second.value == expected);
+        ++expected;
+    }
+    m.reserve(4 * capacity);
+    assert(m.capacity() >= 4 * capacity && m.at(999).value == 999 && !m.contains(7));
+}
+
+int main() {
+    std::cerr << "Starting tests" << std::endl;
+    TestOrder();
+    std::cerr << "TestOrder (1 of 3) passed" << std::endl;
+    TestAgainstUnorderedMap();
+    std::cerr << "TestAgainstUnorderedMap (2 of 3) passed" << std::endl;
+    TestFailedRebuild();
+    std::cerr << "TestFailedRebuild (3 of 3) passed" << std::endl;
+    std::cout << 0;
+}
@@ -0,0 +1,270 @@
+#ifndef UNORDERED_MAP__FROZEN_MAP_H_
+#define UNORDERED_MAP__FROZEN_MAP_H_
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "unordered_map.h"
+
+// An immutable map stored as one flat, offset-only image: a header, then
+// bucket_count + 1 offsets into an entry array grouped by bucket. write()
+// builds the image from an UnorderedMap; open() maps the file and is ready
+// for lookups at once. Keys and values are copied bytewise, so both must be
+// trivially copyable and Hash must give the same result in every process.
+// The file is laid out with the source map's hasher; a seeded one must be
+// passed to open() again.
+template<typename Key, typename Value, typename Hash = std::hash<Key>,
+    typename Equal = std::equal_to<Key>,
+    typename BucketPolicy = ModuloBucketPolicy>
+class FrozenMap {
+  static_assert(std::is_trivially_copyable_v<Key> && std::is_trivially_copyable_v<Value>,
+                "FrozenMap stores keys and values as raw bytes");
+
+ public:
+  struct node_type {
+    Key first;
+    Value second;
+  };
+  using const_iterator = const node_type*;
+
+ private:
+  static const uint64_t MAGIC_ = 0x50414d4e375a4f52ULL;
+  static const uint32_t VERSION_ = 1;
+
+  struct Header {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t node_size;
+    uint64_t size;
+    uint64_t bucket_count;
+  };
+
+  static size_t offsets_position() noexcept;
+  static size_t nodes_position(size_t bucket_count) noexcept;
+
+  void* data_ = nullptr;
+  size_t data_size_ = 0;
+  const Header* header_ = nullptr;
+  const uint64_t* offsets_ = nullptr;
+  const node_type* nodes_ = nullptr;
+  BucketPolicy bucket_policy_ = BucketPolicy();
+  Equal key_equal_ = Equal();
+  Hash hasher_ = Hash();
+
+  FrozenMap(void*, size_t, const Hash&, const Equal&);
+
+ public:
+  template<typename Alloc>
+  static void write(const UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>&, const std::string& path);
+  static FrozenMap open(const std::string& path, const Hash& hasher = Hash(), const Equal& key_equal = Equal());
+
+  FrozenMap(const FrozenMap&) = delete;
+  FrozenMap& operator=(const FrozenMap&) = delete;
+  FrozenMap(FrozenMap&&) noexcept;
+  FrozenMap& operator=(FrozenMap&&) noexcept;
+  ~FrozenMap() noexcept;
+
+  size_t size() const noexcept;
+  size_t bucket_count() const noexcept;
+
+  const_iterator find(const Key&) const noexcept;
+  bool contains(const Key&) const noexcept;
+  const Value& at(const Key&) const;
+
+  const_iterator begin() const noexcept;
+  const_iterator end() const noexcept;
+};
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename BucketPolicy>
+size_t FrozenMap<Key, Value, Hash, Equal, BucketPolicy>::offsets_position() noexcept {
+  return (sizeof(Header) + alignof(uint64_t) - 1) / alignof(uint64_t) * alignof(uint64_t);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename BucketPolicy>
+size_t FrozenMap<Key, Value, Hash, Equal, BucketPolicy>::nodes_position(size_t bucket_count) noexcept {
+  size_t position = offsets_position() + (bucket_count + 1) * sizeof(uint64_t);
+  return (position + alignof(node_type) - 1) / alignof(node_type) * alignof(node_type);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename BucketPolicy>
+FrozenMap<Key, Value, Hash, Equal, BucketPolicy>::FrozenMap(
+    void* data, size_t data_size, const Hash& hasher, const Equal& key_equal) :
+    data_(data), data_size_(data_size), key_equal_(key_equal), hasher_(hasher) {
+  const char* bytes = static_cast<const char*>(data_);
+  header_ = reinterpret_cast<const Header*>(bytes);
+  offsets_ = reinterpret_cast<const uint64_t*>(bytes + offsets_position());
+  nodes_ = reinterpret_cast<const node_type*>(bytes + nodes_position(header_->bucket_count));
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename BucketPolicy>
+template<typename Alloc>
+void FrozenMap<Key, Value, Hash, Equal, BucketPolicy>::write(
+    const UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>& map, const std::string& path) {
+  BucketPolicy bucket_policy;
+  Hash hasher = map.hash_function();
+  Header header{MAGIC_, VERSION_, sizeof(node_type), map.size(),
+                bucket_policy.bucket_count(std::max(map.size(), size_t(1)))};
+
+  // Counting sort by bucket: count, prefix-sum, then place every node.
+  std::vector<uint64_t> offsets(header.bucket_count + 1, 0);
+  for (auto it = map.begin(); it != map.end(); ++it) {
+    ++offsets[bucket_policy(hasher(it->first), header.bucket_count) + 1];
+  }
+  for (size_t i = 1; i < offsets.size(); ++i) {
+    offsets[i] += offsets[i - 1];
+  }
+  std::vector<char> image(nodes_position(header.bucket_count) + map.size() * sizeof(node_type), 0);
+  std::vector<uint64_t> positions(offsets.begin(), offsets.end() - 1);
+  auto* nodes = image.data() + nodes_position(header.bucket_count);
+  for (auto it = map.begin(); it != map.end(); ++it) {
+    uint64_t index = positions[bucket_policy(hasher(it->first), header.bucket_count)]++;
+    std::memcpy(nodes + index * sizeof(node_type) + offsetof(node_type, first), &it->first, sizeof(Key));
+    std::memcpy(nodes + index * sizeof(node_type) + offsetof(node_type, second), &it->second, sizeof(Value));
+  }
+  std::memcpy(image.data(), &header, sizeof(header));
+  std::memcpy(image.data() + offsets_position(), offsets.data(), offsets.size() * sizeof(uint64_t));
+
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write(image.data(), static_cast<std::streamsize>(image.size()));
+  if (!out.flush()) {
+    throw std::runtime_error("cannot write " + path);
+  }
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename BucketPolicy>
+FrozenMap<Key, Value, Hash, Equal, BucketPolicy> FrozenMap<Key, Value, Hash, Equal, BucketPolicy>::open(
+    const std::string& path, const Hash& hasher, const Equal& key_equal) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::system_error(errno, std::generic_category(), "cannot open " + path);
+  }
+  struct stat st{};
+  if (::fstat(fd, &st) < 0) {
+    int error = errno;
+    ::close(fd);
+    throw std::system_error(error, std::generic_category(), "cannot stat " + path);
+  }
+  size_t data_size = static_cast<size_t>(st.st_size);
+  if (data_size < sizeof(Header)) {
+    ::close(fd);
+    throw std::runtime_error(path + " is not a frozen map");
+  }
+  void* data = ::mmap(nullptr, data_size, PROT_READ, MAP_SHARED, fd, 0);
+  int error = errno;
+  ::close(fd);
+  if (data == MAP_FAILED) {
+    throw std::system_error(error, std::generic_category(), "cannot map " + path);
+  }
+
+  const auto& header = *static_cast<const Header*>(data);
+  if (header.magic != MAGIC_ || header.version != VERSION_ || header.node_size != sizeof(node_type) ||
+      header.bucket_count == 0 || header.bucket_count > data_size / sizeof(uint64_t) ||
+      header.size > data_size / sizeof(node_type) ||
+      nodes_position(header.bucket_count) + header.size * sizeof(node_type) != data_size) {
+    ::munmap(data, data_size);
+    throw std::runtime_error(path + " is not a frozen map of this type");
+  }
+  // find() trusts the offsets, so a corrupt file must not get this far.
+  const auto* offsets = reinterpret_cast<const uint64_t*>(static_cast<const char*>(data) + offsets_position());
+  bool sorted = offsets[0] == 0 && offsets[header.bucket_count] == header.size;
+  for (size_t i = 0; sorted && i < header.bucket_count; ++i) {
+    sorted = offsets[i] <= offsets[i + 1];
+  }
+  if (!sorted) {
+    ::munmap(data, data_size);
+    throw std::runtime_error(path + " has corrupt bucket offsets");
+  }
+  return FrozenMap(data, data_size, hasher, key_equal);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename BucketPolicy>
+FrozenMap<Key, Value, Hash, Equal, BucketPolicy>::FrozenMap(FrozenMap&& other) noexcept :
+    data_(other.data_), data_size_(other.data_size_), header_(other.header_), offsets_(other.offsets_),
+    nodes_(other.nodes_), bucket_policy_(std::move(other.bucket_policy_)),
+    key_equal_(std::move(other.key_equal_)), hasher_(std::move(other.hasher_)) {
+  other.data_ = nullptr;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename BucketPolicy>
+FrozenMap<Key, Value, Hash, Equal, BucketPolicy>&
+FrozenMap<Key, Value, Hash, Equal, BucketPolicy>::operator=(FrozenMap&& other) noexcept {
+  if (this != &other) {
+    std::swap(data_, other.data_);
+    std::swap(data_size_, other.data_size_);
+    std::swap(header_, other.header_);
+    std::swap(offsets_, other.offsets_);
+    std::swap(nodes_, other.nodes_);
+    std::swap(bucket_policy_, other.bucket_policy_);
+    std::swap(key_equal_, other.key_equal_);
+    std::swap(hasher_, other.hasher_);
+  }
+  return *this;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename BucketPolicy>
+FrozenMap<Key, Value, Hash, Equal, BucketPolicy>::~FrozenMap() noexcept {
+  if (data_ != nullptr) {
+    ::munmap(data_, data_size_);
+  }
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename BucketPolicy>
+size_t FrozenMap<Key, Value, Hash, Equal, BucketPolicy>::size() const noexcept {
+  return header_->size;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename BucketPolicy>
+size_t FrozenMap<Key, Value, Hash, Equal, BucketPolicy>::bucket_count() const noexcept {
+  return header_->bucket_count;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename BucketPolicy>
+typename FrozenMap<Key, Value, Hash, Equal, BucketPolicy>::const_iterator
+FrozenMap<Key, Value, Hash, Equal, BucketPolicy>::find(const Key& key) const noexcept {
+  size_t index = bucket_policy_(hasher_(key), header_->bucket_count);
+  for (uint64_t i = offsets_[index]; i < offsets_[index + 1]; ++i) {
+    if (key_equal_(key, nodes_[i].first)) {
+      return nodes_ + i;
+    }
+  }
+  return end();
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename BucketPolicy>
+bool FrozenMap<Key, Value, Hash, Equal, BucketPolicy>::contains(const Key& key) const noexcept {
+  return find(key) != end();
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename BucketPolicy>
+const Value& FrozenMap<Key, Value, Hash, Equal, BucketPolicy>::at(const Key& key) const {
+  auto pos = find(key);
+  if (pos == end()) {
+    throw std::range_error("key does not exist");
+  }
+  return pos->second;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename BucketPolicy>
+typename FrozenMap<Key, Value, Hash, Equal, BucketPolicy>::const_iterator
+FrozenMap<Key, Value, Hash, Equal, BucketPolicy>::begin() const noexcept {
+  return nodes_;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename BucketPolicy>
+typename FrozenMap<Key, Value, Hash, Equal, BucketPolicy>::const_iterator
+FrozenMap<Key, Value, Hash, Equal, BucketPolicy>::end() const noexcept {
+  return nodes_ + header_->size;
+}
+
+#endif //UNORDERED_MAP__FROZEN_MAP_H_
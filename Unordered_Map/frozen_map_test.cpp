@@ -0,0 +1,137 @@
+#include "frozen_map.h"
+
+#include <cassert>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+
+struct Point {
+    int x;
+    int y;
+
+    bool operator==(const Point& other) const {
+        return x == other.x && y == other.y;
+    }
+};
+
+struct PointHash {
+    size_t operator()(const Point& point) const {
+        return std::hash<int>()(point.x) * 31 + std::hash<int>()(point.y);
+    }
+};
+
+struct SeededHash {
+    uint64_t seed = 0;
+
+    size_t operator()(int key) const {
+        return (static_cast<uint64_t>(key) ^ seed) * 0x9e3779b97f4a7c15ULL;
+    }
+};
+
+std::string TempPath(const std::string& name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+void TestRoundTrip() {
+    UnorderedMap<int, double> m;
+    for (int i = 0; i < 10'000; ++i) {
+        m.emplace(i * 7, i / 2.0);
+    }
+    std::string path = TempPath("frozen_map_test_round_trip.bin");
+    FrozenMap<int, double>::write(m, path);
+
+    auto frozen = FrozenMap<int, double>::open(path);
+    assert(frozen.size() == m.size());
+    for (int i = 0; i < 70'000; ++i) {
+        auto it = frozen.find(i);
+        assert((it != frozen.end()) == (i % 7 == 0));
+        assert(it == frozen.end() || it->second == i / 7 / 2.0);
+    }
+    assert(frozen.at(700) == 50);
+    bool thrown = false;
+    try {
+        frozen.at(1);
+    } catch (const std::range_error&) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    size_t count = 0;
+    for (const auto& kv : frozen) {
+        assert(m.at(kv.first) == kv.second);
+        ++count;
+    }
+    assert(count == m.size());
+
+    auto moved = std::move(frozen);
+    assert(moved.contains(7) && !moved.contains(8));
+    std::filesystem::remove(path);
+}
+
+void TestCustomHashAndEmpty() {
+    UnorderedMap<Point, int, PointHash> m;
+    for (int i = 0; i < 100; ++i) {
+        m.emplace(Point{i, -i}, i);
+    }
+    std::string path = TempPath("frozen_map_test_points.bin");
+    FrozenMap<Point, int, PointHash>::write(m, path);
+    auto frozen = FrozenMap<Point, int, PointHash>::open(path);
+    assert(frozen.at(Point{42, -42}) == 42);
+    assert(!frozen.contains(Point{42, 42}));
+
+    UnorderedMap<Point, int, PointHash> empty;
+    FrozenMap<Point, int, PointHash>::write(empty, path);
+    auto frozen_empty = FrozenMap<Point, int, PointHash>::open(path);
+    assert(frozen_empty.size() == 0 && !frozen_empty.contains(Point{0, 0}));
+
+    bool thrown = false;
+    try {
+        FrozenMap<int, int>::open(path);
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    assert(thrown);
+    std::filesystem::remove(path);
+}
+
+void TestSeededHashAndCorruptFile() {
+    SeededHash hasher{12345};
+    UnorderedMap<int, int, SeededHash> m(0, hasher, std::equal_to<int>(), std::allocator<std::pair<const int, int>>());
+    for (int i = 0; i < 1000; ++i) {
+        m.emplace(i, -i);
+    }
+    std::string path = TempPath("frozen_map_test_seeded.bin");
+    FrozenMap<int, int, SeededHash>::write(m, path);
+    auto frozen = FrozenMap<int, int, SeededHash>::open(path, hasher);
+    for (int i = 0; i < 1000; ++i) {
+        assert(frozen.at(i) == -i);
+    }
+    assert(!frozen.contains(1000));
+
+    // An offset past the entries is refused instead of read out of bounds.
+    {
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        uint64_t offset = 1'000'000;
+        file.seekp(40);
+        file.write(reinterpret_cast<const char*>(&offset), sizeof(offset));
+    }
+    bool thrown = false;
+    try {
+        FrozenMap<int, int, SeededHash>::open(path, hasher);
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    assert(thrown);
+    std::filesystem::remove(path);
+}
+
+int main() {
+    std::cerr << "Starting tests" << std::endl;
+    TestRoundTrip();
+    std::cerr << "TestRoundTrip (1 of 3) passed" << std::endl;
+    TestCustomHashAndEmpty();
+    std::cerr << "TestCustomHashAndEmpty (2 of 3) passed" << std::endl;
+    TestSeededHashAndCorruptFile();
+    std::cerr << "TestSeededHashAndCorruptFile (3 of 3) passed" << std::endl;
+    std::cout << 0;
+}
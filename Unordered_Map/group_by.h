@@ -0,0 +1,284 @@
+#ifndef UNORDERED_MAP__GROUP_BY_H_
+#define UNORDERED_MAP__GROUP_BY_H_
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "soa_map.h"
+#include "unordered_map.h"
+
+// Running count, sum, min and max of the values of one group. Sums are kept
+// in Value, so integral sums may overflow like a hand-written loop would.
+template<typename Value>
+struct Aggregate {
+  static_assert(std::is_arithmetic_v<Value>, "Aggregate needs arithmetic values");
+
+  size_t count = 0;
+  Value sum = Value();
+  Value min = std::numeric_limits<Value>::max();
+  Value max = std::numeric_limits<Value>::lowest();
+
+  void add(Value value) noexcept {
+    ++count;
+    sum += value;
+    min = std::min(min, value);
+    max = std::max(max, value);
+  }
+
+  void merge(const Aggregate& other) noexcept {
+    count += other.count;
+    sum += other.sum;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+  }
+
+  double avg() const noexcept {
+    return count == 0 ? 0 : static_cast<double>(sum) / count;
+  }
+};
+
+// Group-by aggregation over columnar row batches: keys[i] and values[i] form
+// row i. Groups are split by hash into partitions, each a SoaMap from keys to
+// aggregates. A batch is hashed a window at a time and the home slots of the
+// window are prefetched before any of its rows is folded in.
+//
+// parallel_add gives every thread a slice of the rows and a private GroupBy
+// with the same partitions; in the final merge each thread owns a partition
+// and folds that partition of every private GroupBy into this one, reusing
+// the stored hashes, so no locks are taken. The merge runs on at most
+// partition_count() threads.
+template<typename Key, typename Value, typename Hash = std::hash<Key>,
+    typename Equal = std::equal_to<Key>,
+    typename Alloc = std::allocator<std::pair<const Key, Aggregate<Value>>>>
+class GroupBy {
+ public:
+  using AllocTraits = std::allocator_traits<Alloc>;
+  using aggregate_type = Aggregate<Value>;
+
+ private:
+  static const size_t WINDOW_ = 32;
+
+  using Partition = SoaMap<Key, aggregate_type, Hash, Equal, Alloc>;
+  using PartitionAlloc = typename AllocTraits::template rebind_alloc<Partition>;
+
+  std::vector<Partition, PartitionAlloc> partitions_;
+  Equal key_equal_;
+  Hash hasher_;
+  Alloc allocator_;
+
+  // The hash every partition stores for the key.
+  size_t get_hash(const Key&) const noexcept;
+  Partition& partition_for(size_t) noexcept;
+  // The aggregate of the key, inserted empty if the key is new.
+  aggregate_type& aggregate(const Key&, size_t);
+  void merge_partition(Partition&, const Partition&);
+
+ public:
+  explicit GroupBy(size_t partitions = 1, const Hash& hasher = Hash(), const Equal& key_equal = Equal(),
+                   const Alloc& alloc = Alloc());
+
+  size_t size() const noexcept;
+  bool empty() const noexcept;
+  size_t partition_count() const noexcept;
+
+  void add(const Key&, const Value&);
+  // Adds count rows, keys[i] with values[i].
+  void add_batch(const Key*, const Value*, size_t);
+  // Same as add_batch, spread over threads; the hasher, key_equal and
+  // allocator are copied to every thread and must be thread-safe.
+  void parallel_add(const Key*, const Value*, size_t, size_t threads);
+  // Folds every group of other into this one.
+  void merge(const GroupBy&);
+
+  // The aggregate of the key, or nullptr.
+  const aggregate_type* find(const Key&) const noexcept;
+  const aggregate_type& at(const Key&) const;
+
+  // Calls function(key, aggregate) for every group, partition by partition.
+  template<typename Function>
+  void for_each(Function&&) const;
+  UnorderedMap<Key, aggregate_type, Hash, Equal, Alloc> to_map() const;
+
+  // Sizes every partition for the given number of groups in total.
+  void reserve(size_t);
+  void clear() noexcept;
+};
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+GroupBy<Key, Value, Hash, Equal, Alloc>::GroupBy(
+    size_t partitions, const Hash& hasher, const Equal& key_equal, const Alloc& alloc) :
+    partitions_(PartitionAlloc(alloc)), key_equal_(key_equal), hasher_(hasher), allocator_(alloc) {
+  partitions = std::max(partitions, size_t(1));
+  partitions_.reserve(partitions);
+  for (size_t i = 0; i < partitions; ++i) {
+    partitions_.emplace_back(0, hasher, key_equal, alloc);
+  }
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+size_t GroupBy<Key, Value, Hash, Equal, Alloc>::get_hash(const Key& key) const noexcept {
+  return partitions_.front().hash(key);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+typename GroupBy<Key, Value, Hash, Equal, Alloc>::Partition&
+GroupBy<Key, Value, Hash, Equal, Alloc>::partition_for(size_t hash) noexcept {
+  return partitions_[partition_of(hash, partitions_.size())];
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+typename GroupBy<Key, Value, Hash, Equal, Alloc>::aggregate_type&
+GroupBy<Key, Value, Hash, Equal, Alloc>::aggregate(const Key& key, size_t hash) {
+  return *partition_for(hash).emplace_hashed(key, hash).first;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+void GroupBy<Key, Value, Hash, Equal, Alloc>::merge_partition(Partition& into, const Partition& from) {
+  from.for_each_hashed([&into](const Key& key, const aggregate_type& aggregate, size_t hash) {
+    into.emplace_hashed(key, hash).first->merge(aggregate);
+  });
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+size_t GroupBy<Key, Value, Hash, Equal, Alloc>::size() const noexcept {
+  size_t result = 0;
+  for (const Partition& partition : partitions_) {
+    result += partition.size();
+  }
+  return result;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+bool GroupBy<Key, Value, Hash, Equal, Alloc>::empty() const noexcept {
+  return size() == 0;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+size_t GroupBy<Key, Value, Hash, Equal, Alloc>::partition_count() const noexcept {
+  return partitions_.size();
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+void GroupBy<Key, Value, Hash, Equal, Alloc>::add(const Key& key, const Value& value) {
+  aggregate(key, get_hash(key)).add(value);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+void GroupBy<Key, Value, Hash, Equal, Alloc>::add_batch(const Key* keys, const Value* values, size_t count) {
+  size_t hashes[WINDOW_];
+  for (size_t first = 0; first < count; first += WINDOW_) {
+    size_t window = std::min(size_t(WINDOW_), count - first);
+    for (size_t i = 0; i < window; ++i) {
+      hashes[i] = get_hash(keys[first + i]);
+      __builtin_prefetch(partition_for(hashes[i]).home_slot(hashes[i]));
+    }
+    for (size_t i = 0; i < window; ++i) {
+      aggregate(keys[first + i], hashes[i]).add(values[first + i]);
+    }
+  }
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+void GroupBy<Key, Value, Hash, Equal, Alloc>::parallel_add(
+    const Key* keys, const Value* values, size_t count, size_t threads) {
+  if (threads <= 1 || count < threads) {
+    add_batch(keys, values, count);
+    return;
+  }
+  std::vector<GroupBy> locals;
+  locals.reserve(threads);
+  for (size_t i = 0; i < threads; ++i) {
+    locals.emplace_back(partitions_.size(), hasher_, key_equal_, allocator_);
+  }
+  run_parallel(threads, [&](size_t slice) {
+    size_t first = count * slice / threads;
+    size_t last = count * (slice + 1) / threads;
+    locals[slice].add_batch(keys + first, values + first, last - first);
+  });
+  size_t workers = std::min(threads, partitions_.size());
+  run_parallel(workers, [&](size_t worker) {
+    for (size_t partition = worker; partition < partitions_.size(); partition += workers) {
+      for (const GroupBy& local : locals) {
+        merge_partition(partitions_[partition], local.partitions_[partition]);
+      }
+    }
+  });
+}
+
+// Partitions only line up when the counts match; otherwise every group is
+// routed again by its stored hash.
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+void GroupBy<Key, Value, Hash, Equal, Alloc>::merge(const GroupBy& other) {
+  if (this == &other) {
+    GroupBy copy(other);
+    merge(copy);
+    return;
+  }
+  if (other.partitions_.size() == partitions_.size()) {
+    for (size_t i = 0; i < partitions_.size(); ++i) {
+      merge_partition(partitions_[i], other.partitions_[i]);
+    }
+    return;
+  }
+  for (const Partition& partition : other.partitions_) {
+    partition.for_each_hashed([this](const Key& key, const aggregate_type& aggregate, size_t hash) {
+      this->aggregate(key, hash).merge(aggregate);
+    });
+  }
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+const typename GroupBy<Key, Value, Hash, Equal, Alloc>::aggregate_type*
+GroupBy<Key, Value, Hash, Equal, Alloc>::find(const Key& key) const noexcept {
+  size_t hash = get_hash(key);
+  return partitions_[partition_of(hash, partitions_.size())].find(key, hash);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+const typename GroupBy<Key, Value, Hash, Equal, Alloc>::aggregate_type&
+GroupBy<Key, Value, Hash, Equal, Alloc>::at(const Key& key) const {
+  const aggregate_type* result = find(key);
+  if (result == nullptr) {
+    throw std::range_error("key does not exist");
+  }
+  return *result;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+template<typename Function>
+void GroupBy<Key, Value, Hash, Equal, Alloc>::for_each(Function&& function) const {
+  for (const Partition& partition : partitions_) {
+    partition.for_each(function);
+  }
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+UnorderedMap<Key, Aggregate<Value>, Hash, Equal, Alloc> GroupBy<Key, Value, Hash, Equal, Alloc>::to_map() const {
+  UnorderedMap<Key, aggregate_type, Hash, Equal, Alloc> result(0, hasher_, key_equal_, allocator_);
+  result.reserve(size());
+  for_each([&result](const Key& key, const aggregate_type& aggregate) {
+    result.emplace(key, aggregate);
+  });
+  return result;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+void GroupBy<Key, Value, Hash, Equal, Alloc>::reserve(size_t count) {
+  // Hashing spreads groups evenly; leave some slack for the unlucky partition.
+  size_t per_partition = count / partitions_.size() + count / partitions_.size() / 8 + 1;
+  for (Partition& partition : partitions_) {
+    partition.reserve(per_partition);
+  }
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+void GroupBy<Key, Value, Hash, Equal, Alloc>::clear() noexcept {
+  for (Partition& partition : partitions_) {
+    partition.clear();
+  }
+}
+
+#endif //UNORDERED_MAP__GROUP_BY_H_
@@ -0,0 +1,98 @@
+#include "group_by.h"
+
+#include <cassert>
+#include <random>
+#include <string>
+#include <vector>
+
+void TestAggregates() {
+    GroupBy<std::string, int> groups;
+    std::vector<std::string> keys{"a", "b", "a", "c", "a", "b"};
+    std::vector<int> values{5, -2, 1, 7, 3, 4};
+    groups.add_batch(keys.data(), values.data(), keys.size());
+    groups.add("c", -7);
+    assert(groups.size() == 3 && groups.find("d") == nullptr);
+
+    const auto& a = groups.at("a");
+    assert(a.count == 3 && a.sum == 9 && a.min == 1 && a.max == 5 && a.avg() == 3);
+    const auto& b = *groups.find("b");
+    assert(b.count == 2 && b.sum == 2 && b.min == -2 && b.max == 4);
+    assert(groups.at("c").avg() == 0 && groups.at("c").min == -7);
+
+    bool thrown = false;
+    try {
+        groups.at("d");
+    } catch (const std::range_error&) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    GroupBy<std::string, int> other(4);
+    other.add("a", 100);
+    other.add("d", 0);
+    groups.merge(other);
+    assert(groups.size() == 4 && groups.at("a").max == 100 && groups.at("a").count == 4);
+    groups.merge(groups);
+    assert(groups.at("d").count == 2 && groups.at("b").sum == 4);
+
+    auto map = groups.to_map();
+    assert(map.size() == 4 && map.at("a").sum == 218);
+    groups.clear();
+    assert(groups.empty() && groups.find("a") == nullptr);
+    groups.add("a", 1);
+    assert(groups.at("a").count == 1);
+}
+
+// Batch, parallel and merged aggregation all agree with operator[] accumulation.
+void TestAgainstUnorderedMap() {
+    const size_t rows = 300'000;
+    std::vector<long long> keys(rows);
+    std::vector<double> values(rows);
+    std::mt19937 gen(17);
+    for (size_t i = 0; i < rows; ++i) {
+        keys[i] = gen() % 20'000;
+        values[i] = static_cast<double>(gen() % 1000) - 500;
+    }
+    UnorderedMap<long long, Aggregate<double>> reference;
+    for (size_t i = 0; i < rows; ++i) {
+        reference[keys[i]].add(values[i]);
+    }
+
+    auto check = [&reference](const GroupBy<long long, double>& groups) {
+        assert(groups.size() == reference.size());
+        size_t count = 0;
+        groups.for_each([&](long long key, const Aggregate<double>& aggregate) {
+            const auto& expected = reference.at(key);
+            assert(aggregate.count == expected.count && aggregate.sum == expected.sum);
+            assert(aggregate.min == expected.min && aggregate.max == expected.max);
+            count += aggregate.count;
+        });
+        assert(count == rows);
+    };
+
+    GroupBy<long long, double> batch;
+    batch.add_batch(keys.data(), values.data(), rows);
+    check(batch);
+
+    GroupBy<long long, double> parallel(8);
+    parallel.reserve(20'000);
+    parallel.parallel_add(keys.data(), values.data(), rows, 4);
+    assert(parallel.partition_count() == 8);
+    check(parallel);
+
+    GroupBy<long long, double> halves(3);
+    GroupBy<long long, double> second;
+    halves.add_batch(keys.data(), values.data(), rows / 2);
+    second.parallel_add(keys.data() + rows / 2, values.data() + rows / 2, rows - rows / 2, 3);
+    halves.merge(second);
+    check(halves);
+}
+
+int main() {
+    std::cerr << "Starting tests" << std::endl;
+    TestAggregates();
+    std::cerr << "TestAggregates (1 of 2) passed" << std::endl;
+    TestAgainstUnorderedMap();
+    std::cerr << "TestAgainstUnorderedMap (2 of 2) passed" << std::endl;
+    std::cout << 0;
+}
@@ -0,0 +1,273 @@
+#ifndef UNORDERED_MAP__HASH_JOIN_H_
+#define UNORDERED_MAP__HASH_JOIN_H_
+
+#include <algorithm>
+#include <vector>
+
+#include "unordered_map.h"
+
+// Build/probe equi-join over key columns: build rows are indices into the
+// build keys, probe rows indices into the probe keys, and every pair with
+// equal keys is passed to a callback as emit(build_row, probe_row).
+//
+// The table is flat: build rows are split by hash into partitions, and each
+// partition is bucket-sorted into (hash, row) entries with one offset per
+// bucket, so a bucket is a contiguous run and duplicate keys need no chains.
+// The build keys are copied. Probing takes a window of rows at a time and
+// prefetches their bucket offsets, then their entries, before comparing.
+//
+// With several threads both sides are radix-partitioned: every thread hashes
+// a slice of the rows and counts them per partition, the rows are scattered
+// into partition order, and then each thread builds or probes whole
+// partitions of its own. That stage runs on at most partition_count()
+// threads, and the probe side calls emit from all of them concurrently.
+template<typename Key, typename Hash = std::hash<Key>, typename Equal = std::equal_to<Key>,
+    typename Alloc = std::allocator<Key>>
+class HashJoin {
+ public:
+  using AllocTraits = std::allocator_traits<Alloc>;
+
+ private:
+  static const size_t WINDOW_ = 32;
+
+  struct Entry {
+    size_t hash;
+    size_t row;
+  };
+
+  struct Partition {
+    size_t first_bucket = 0;
+    size_t mask = 0;
+  };
+
+  using KeyAlloc = typename AllocTraits::template rebind_alloc<Key>;
+  using EntryAlloc = typename AllocTraits::template rebind_alloc<Entry>;
+  using SizeAlloc = typename AllocTraits::template rebind_alloc<size_t>;
+  using PartitionAlloc = typename AllocTraits::template rebind_alloc<Partition>;
+
+  std::vector<Key, KeyAlloc> keys_;
+  // Entries of partition p start at partition_starts_[p], in bucket order;
+  // bucket b of p spans [bucket_starts_[first_bucket + b], the next offset).
+  std::vector<Entry, EntryAlloc> entries_;
+  std::vector<size_t, SizeAlloc> partition_starts_;
+  std::vector<size_t, SizeAlloc> bucket_starts_;
+  std::vector<Partition, PartitionAlloc> partitions_;
+  Hash hasher_;
+  Equal key_equal_;
+
+  size_t get_hash(const Key&) const noexcept;
+  // Hashes the keys into hashes and writes their rows to order grouped by
+  // partition; returns the partition_count() + 1 starts of the groups.
+  std::vector<size_t> partition_rows(const Key*, size_t, size_t, std::vector<size_t>&,
+                                     std::vector<size_t>&) const;
+  void build_partition(size_t, const std::vector<size_t>&, const std::vector<size_t>&);
+  template<typename RowAt, typename Function>
+  void probe_rows(const Key*, size_t, RowAt&&, Function&) const;
+
+ public:
+  explicit HashJoin(size_t partitions = 1, const Hash& hasher = Hash(), const Equal& key_equal = Equal(),
+                    const Alloc& alloc = Alloc());
+
+  // Replaces the table with the given build keys, row i being keys[i].
+  void build(const Key*, size_t, size_t threads = 1);
+  // Calls emit(build_row, probe_row) for every match of the count probe keys.
+  template<typename Function>
+  void probe(const Key*, size_t, Function&&, size_t threads = 1) const;
+  // Calls emit(build_row) for every build row with the key.
+  template<typename Function>
+  void for_each_match(const Key&, Function&&) const;
+
+  size_t size() const noexcept;
+  size_t partition_count() const noexcept;
+  size_t bucket_count() const noexcept;
+};
+
+template<typename Key, typename Hash, typename Equal, typename Alloc>
+HashJoin<Key, Hash, Equal, Alloc>::HashJoin(size_t partitions, const Hash& hasher, const Equal& key_equal,
+                                            const Alloc& alloc) :
+    keys_(KeyAlloc(alloc)), entries_(EntryAlloc(alloc)), partition_starts_(SizeAlloc(alloc)),
+    bucket_starts_(SizeAlloc(alloc)), partitions_(std::max(partitions, size_t(1)), Partition(), PartitionAlloc(alloc)),
+    hasher_(hasher), key_equal_(key_equal) {
+  partition_starts_.assign(partitions_.size() + 1, 0);
+  bucket_starts_.assign(2 * partitions_.size(), 0);
+  for (size_t i = 0; i < partitions_.size(); ++i) {
+    partitions_[i].first_bucket = 2 * i;
+  }
+}
+
+template<typename Key, typename Hash, typename Equal, typename Alloc>
+size_t HashJoin<Key, Hash, Equal, Alloc>::get_hash(const Key& key) const noexcept {
+  return mix_hash(hasher_(key));
+}
+
+template<typename Key, typename Hash, typename Equal, typename Alloc>
+std::vector<size_t> HashJoin<Key, Hash, Equal, Alloc>::partition_rows(
+    const Key* keys, size_t count, size_t threads, std::vector<size_t>& hashes, std::vector<size_t>& order) const {
+  size_t partitions = partitions_.size();
+  hashes.resize(count);
+  order.resize(count);
+  std::vector<size_t> counts(threads * partitions, 0);
+  run_parallel(threads, [&](size_t slice) {
+    for (size_t i = count * slice / threads; i < count * (slice + 1) / threads; ++i) {
+      hashes[i] = get_hash(keys[i]);
+      ++counts[slice * partitions + partition_of(hashes[i], partitions)];
+    }
+  });
+  // Partition-major offsets, so each slice writes its own part of every group.
+  std::vector<size_t> starts(partitions + 1, 0);
+  size_t total = 0;
+  for (size_t partition = 0; partition < partitions; ++partition) {
+    starts[partition] = total;
+    for (size_t slice = 0; slice < threads; ++slice) {
+      size_t rows = counts[slice * partitions + partition];
+      counts[slice * partitions + partition] = total;
+      total += rows;
+    }
+  }
+  starts[partitions] = total;
+  run_parallel(threads, [&](size_t slice) {
+    for (size_t i = count * slice / threads; i < count * (slice + 1) / threads; ++i) {
+      order[counts[slice * partitions + partition_of(hashes[i], partitions)]++] = i;
+    }
+  });
+  return starts;
+}
+
+// A counting sort of the partition's rows by bucket; there are as many
+// buckets as rows, rounded up to a power of two.
+template<typename Key, typename Hash, typename Equal, typename Alloc>
+void HashJoin<Key, Hash, Equal, Alloc>::build_partition(
+    size_t partition, const std::vector<size_t>& hashes, const std::vector<size_t>& order) {
+  size_t first = partition_starts_[partition];
+  size_t last = partition_starts_[partition + 1];
+  size_t* starts = bucket_starts_.data() + partitions_[partition].first_bucket;
+  size_t mask = partitions_[partition].mask;
+  for (size_t i = first; i < last; ++i) {
+    ++starts[hashes[order[i]] & mask];
+  }
+  size_t offset = first;
+  for (size_t bucket = 0; bucket <= mask; ++bucket) {
+    size_t rows = starts[bucket];
+    starts[bucket] = offset;
+    offset += rows;
+  }
+  // Filling advances every offset to the end of its bucket, which is where
+  // the next bucket starts.
+  for (size_t i = first; i < last; ++i) {
+    size_t row = order[i];
+    entries_[starts[hashes[row] & mask]++] = Entry{hashes[row], row};
+  }
+  for (size_t bucket = mask + 1; bucket > 0; --bucket) {
+    starts[bucket] = starts[bucket - 1];
+  }
+  starts[0] = first;
+}
+
+template<typename Key, typename Hash, typename Equal, typename Alloc>
+void HashJoin<Key, Hash, Equal, Alloc>::build(const Key* keys, size_t count, size_t threads) {
+  threads = std::max(size_t(1), std::min(threads, count));
+  keys_.assign(keys, keys + count);
+  std::vector<size_t> hashes;
+  std::vector<size_t> order;
+  auto starts = partition_rows(keys, count, threads, hashes, order);
+  std::copy(starts.begin(), starts.end(), partition_starts_.begin());
+
+  size_t buckets = 0;
+  for (size_t partition = 0; partition < partitions_.size(); ++partition) {
+    size_t rows = starts[partition + 1] - starts[partition];
+    size_t bucket_count = 1;
+    while (bucket_count < rows) {
+      bucket_count *= 2;
+    }
+    partitions_[partition].first_bucket = buckets;
+    partitions_[partition].mask = bucket_count - 1;
+    buckets += bucket_count + 1;
+  }
+  bucket_starts_.assign(buckets, 0);
+  entries_.resize(count);
+
+  size_t workers = std::min(threads, partitions_.size());
+  run_parallel(workers, [&](size_t worker) {
+    for (size_t partition = worker; partition < partitions_.size(); partition += workers) {
+      build_partition(partition, hashes, order);
+    }
+  });
+}
+
+template<typename Key, typename Hash, typename Equal, typename Alloc>
+template<typename RowAt, typename Function>
+void HashJoin<Key, Hash, Equal, Alloc>::probe_rows(
+    const Key* keys, size_t count, RowAt&& row_at, Function& emit) const {
+  size_t rows[WINDOW_];
+  size_t hashes[WINDOW_];
+  const size_t* buckets[WINDOW_];
+  for (size_t first = 0; first < count; first += WINDOW_) {
+    size_t window = std::min(size_t(WINDOW_), count - first);
+    for (size_t i = 0; i < window; ++i) {
+      rows[i] = row_at(first + i);
+      hashes[i] = get_hash(keys[rows[i]]);
+      const Partition& partition = partitions_[partition_of(hashes[i], partitions_.size())];
+      buckets[i] = &bucket_starts_[partition.first_bucket + (hashes[i] & partition.mask)];
+      __builtin_prefetch(buckets[i]);
+    }
+    for (size_t i = 0; i < window; ++i) {
+      __builtin_prefetch(entries_.data() + *buckets[i]);
+    }
+    for (size_t i = 0; i < window; ++i) {
+      for (size_t entry = buckets[i][0]; entry < buckets[i][1]; ++entry) {
+        if (entries_[entry].hash == hashes[i] && key_equal_(keys_[entries_[entry].row], keys[rows[i]])) {
+          emit(entries_[entry].row, rows[i]);
+        }
+      }
+    }
+  }
+}
+
+template<typename Key, typename Hash, typename Equal, typename Alloc>
+template<typename Function>
+void HashJoin<Key, Hash, Equal, Alloc>::probe(const Key* keys, size_t count, Function&& emit, size_t threads) const {
+  if (threads <= 1 || count < threads) {
+    probe_rows(keys, count, [](size_t i) { return i; }, emit);
+    return;
+  }
+  std::vector<size_t> hashes;
+  std::vector<size_t> order;
+  auto starts = partition_rows(keys, count, threads, hashes, order);
+  size_t workers = std::min(threads, partitions_.size());
+  run_parallel(workers, [&](size_t worker) {
+    for (size_t partition = worker; partition < partitions_.size(); partition += workers) {
+      size_t first = starts[partition];
+      probe_rows(keys, starts[partition + 1] - first, [&order, first](size_t i) { return order[first + i]; }, emit);
+    }
+  });
+}
+
+template<typename Key, typename Hash, typename Equal, typename Alloc>
+template<typename Function>
+void HashJoin<Key, Hash, Equal, Alloc>::for_each_match(const Key& key, Function&& emit) const {
+  size_t hash = get_hash(key);
+  const Partition& partition = partitions_[partition_of(hash, partitions_.size())];
+  const size_t* bucket = &bucket_starts_[partition.first_bucket + (hash & partition.mask)];
+  for (size_t entry = bucket[0]; entry < bucket[1]; ++entry) {
+    if (entries_[entry].hash == hash && key_equal_(keys_[entries_[entry].row], key)) {
+      emit(entries_[entry].row);
+    }
+  }
+}
+
+template<typename Key, typename Hash, typename Equal, typename Alloc>
+size_t HashJoin<Key, Hash, Equal, Alloc>::size() const noexcept {
+  return keys_.size();
+}
+
+template<typename Key, typename Hash, typename Equal, typename Alloc>
+size_t HashJoin<Key, Hash, Equal, Alloc>::partition_count() const noexcept {
+  return partitions_.size();
+}
+
+template<typename Key, typename Hash, typename Equal, typename Alloc>
+size_t HashJoin<Key, Hash, Equal, Alloc>::bucket_count() const noexcept {
+  return bucket_starts_.size() - partitions_.size();
+}
+
+#endif //UNORDERED_MAP__HASH_JOIN_H_
@@ -0,0 +1,96 @@
+#include "hash_join.h"
+
+#include <algorithm>
+#include <cassert>
+#include <mutex>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+void TestMatches() {
+    HashJoin<std::string> join;
+    std::vector<std::pair<size_t, size_t>> matches;
+    auto emit = [&matches](size_t build_row, size_t probe_row) {
+        matches.emplace_back(build_row, probe_row);
+    };
+    join.probe(nullptr, 0, emit);
+    std::string missing = "a";
+    join.probe(&missing, 1, emit);
+    assert(join.size() == 0 && matches.empty());
+
+    // Duplicate keys on both sides give every pair.
+    std::vector<std::string> build{"a", "b", "a", "c"};
+    std::vector<std::string> probe{"c", "a", "d", "a"};
+    join.build(build.data(), build.size());
+    join.probe(probe.data(), probe.size(), emit);
+    std::sort(matches.begin(), matches.end());
+    assert((matches == std::vector<std::pair<size_t, size_t>>{{0, 1}, {0, 3}, {2, 1}, {2, 3}, {3, 0}}));
+
+    std::vector<size_t> rows;
+    join.for_each_match("a", [&rows](size_t row) { rows.push_back(row); });
+    assert((rows == std::vector<size_t>{0, 2}));
+    join.for_each_match("z", [&rows](size_t row) { rows.push_back(row); });
+    assert(rows.size() == 2 && join.bucket_count() >= 4);
+
+    // Building again replaces the table.
+    join.build(probe.data(), 2);
+    rows.clear();
+    join.for_each_match("a", [&rows](size_t row) { rows.push_back(row); });
+    assert(join.size() == 2 && (rows == std::vector<size_t>{1}));
+}
+
+// Serial and partitioned joins agree with a nested find over UnorderedMap.
+void TestAgainstUnorderedMap() {
+    const size_t build_rows = 50'000;
+    const size_t probe_rows = 200'000;
+    std::mt19937 gen(23);
+    std::vector<int> build(build_rows);
+    std::vector<int> probe(probe_rows);
+    for (auto& key : build) {
+        key = static_cast<int>(gen() % 40'000);
+    }
+    for (auto& key : probe) {
+        key = static_cast<int>(gen() % 80'000);
+    }
+
+    UnorderedMap<int, std::vector<size_t>> reference;
+    for (size_t i = 0; i < build_rows; ++i) {
+        reference[build[i]].push_back(i);
+    }
+    std::vector<std::pair<size_t, size_t>> expected;
+    for (size_t i = 0; i < probe_rows; ++i) {
+        auto it = reference.find(probe[i]);
+        if (it != reference.end()) {
+            for (size_t row : it->second) {
+                expected.emplace_back(row, i);
+            }
+        }
+    }
+    std::sort(expected.begin(), expected.end());
+
+    for (size_t partitions : {1, 3, 8}) {
+        for (size_t threads : {1, 4}) {
+            HashJoin<int> join(partitions);
+            join.build(build.data(), build.size(), threads);
+            assert(join.size() == build_rows && join.partition_count() == partitions);
+            std::mutex mutex;
+            std::vector<std::pair<size_t, size_t>> matches;
+            join.probe(probe.data(), probe.size(), [&](size_t build_row, size_t probe_row) {
+                std::lock_guard<std::mutex> lock(mutex);
+                matches.emplace_back(build_row, probe_row);
+            }, threads);
+            std::sort(matches.begin(), matches.end());
+            assert(matches == expected);
+        }
+    }
+}
+
+int main() {
+    std::cerr << "Starting tests" << std::endl;
+    TestMatches();
+    std::cerr << "TestMatches (1 of 2) passed" << std::endl;
+    TestAgainstUnorderedMap();
+    std::cerr << "TestAgainstUnorderedMap (2 of 2) passed" << std::endl;
+    std::cout << 0;
+}
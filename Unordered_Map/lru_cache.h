@@ -0,0 +1,217 @@
+#ifndef UNORDERED_MAP__LRU_CACHE_H_
+#define UNORDERED_MAP__LRU_CACHE_H_
+
+#include <functional>
+#include <tuple>
+
+#include "unordered_map.h"
+
+// A least-recently-used cache whose entries are UnorderedMap nodes: the
+// recency list is threaded through the mapped values, which never move, so
+// an entry costs exactly one map insertion and touching it relinks its two
+// neighbours. Every entry has a charge (1 by default) and the oldest entries
+// are evicted while the charges add up to more than the capacity; capacity
+// is in entries or, with byte sizes as charges, in bytes. The eviction
+// callback sees each evicted entry before it is destroyed.
+template<typename Key, typename Value, typename Hash = std::hash<Key>,
+    typename Equal = std::equal_to<Key>,
+    typename Alloc = std::allocator<std::pair<const Key, Value>>>
+class LruCache {
+ public:
+  using EvictionCallback = std::function<void(const Key&, Value&)>;
+
+ private:
+  struct Entry;
+  using map_type = UnorderedMap<Key, Entry, Hash, Equal,
+      typename std::allocator_traits<Alloc>::template rebind_alloc<std::pair<const Key, Entry>>>;
+  using node_type = typename map_type::node_type;
+
+  // The links point straight at the neighbouring map values, so touching an
+  // entry reads no list nodes; they are nullptr at the ends.
+  struct Entry {
+    Value value;
+    size_t charge;
+    node_type* newer;
+    node_type* older;
+
+    template<typename V>
+    Entry(V&&, size_t);
+  };
+
+  size_t capacity_;
+  size_t charge_ = 0;
+  map_type map_;
+  node_type* newest_ = nullptr;
+  node_type* oldest_ = nullptr;
+  EvictionCallback on_evict_;
+
+  void unlink(node_type*) noexcept;
+  void push_newest(node_type*) noexcept;
+  template<typename V>
+  void put_value(const Key&, V&&, size_t);
+  void evict();
+
+ public:
+  explicit LruCache(size_t capacity, EvictionCallback on_evict = EvictionCallback(),
+                    const Hash& hasher = Hash(), const Equal& key_equal = Equal(), const Alloc& alloc = Alloc());
+  LruCache(const LruCache&) = delete;
+  LruCache& operator=(const LruCache&) = delete;
+
+  size_t size() const noexcept;
+  size_t charge() const noexcept;
+  size_t capacity() const noexcept;
+  // Evicts down to the new capacity at once.
+  void capacity(size_t);
+
+  // Makes the entry the newest; the pointer is valid until it is evicted or erased.
+  Value* get(const Key&);
+  // Looks the entry up without touching its recency.
+  const Value* peek(const Key&) const noexcept;
+  bool contains(const Key&) const noexcept;
+
+  // Inserts or replaces the value, makes it the newest and then evicts.
+  void put(const Key&, const Value&, size_t charge = 1);
+  void put(const Key&, Value&&, size_t charge = 1);
+  // Erased entries are not reported to the eviction callback.
+  bool erase(const Key&);
+};
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+template<typename V>
+LruCache<Key, Value, Hash, Equal, Alloc>::Entry::Entry(V&& value, size_t charge) :
+    value(std::forward<V>(value)), charge(charge), newer(nullptr), older(nullptr) {}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+LruCache<Key, Value, Hash, Equal, Alloc>::LruCache(
+    size_t capacity, EvictionCallback on_evict, const Hash& hasher, const Equal& key_equal, const Alloc& alloc) :
+    capacity_(capacity), map_(0, hasher, key_equal, typename map_type::AllocTraits::allocator_type(alloc)),
+    on_evict_(std::move(on_evict)) {}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+void LruCache<Key, Value, Hash, Equal, Alloc>::unlink(node_type* node) noexcept {
+  auto& entry = node->second;
+  if (entry.newer == nullptr) {
+    newest_ = entry.older;
+  } else {
+    entry.newer->second.older = entry.older;
+  }
+  if (entry.older == nullptr) {
+    oldest_ = entry.newer;
+  } else {
+    entry.older->second.newer = entry.newer;
+  }
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+void LruCache<Key, Value, Hash, Equal, Alloc>::push_newest(node_type* node) noexcept {
+  auto& entry = node->second;
+  entry.newer = nullptr;
+  entry.older = newest_;
+  if (newest_ == nullptr) {
+    oldest_ = node;
+  } else {
+    newest_->second.newer = node;
+  }
+  newest_ = node;
+}
+
+// The callback runs first, so an entry stays cached if it throws.
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+void LruCache<Key, Value, Hash, Equal, Alloc>::evict() {
+  while (charge_ > capacity_ && oldest_ != nullptr) {
+    node_type* victim = oldest_;
+    if (on_evict_) {
+      on_evict_(victim->first, victim->second.value);
+    }
+    unlink(victim);
+    charge_ -= victim->second.charge;
+    map_.erase(victim->first);
+  }
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+size_t LruCache<Key, Value, Hash, Equal, Alloc>::size() const noexcept {
+  return map_.size();
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+size_t LruCache<Key, Value, Hash, Equal, Alloc>::charge() const noexcept {
+  return charge_;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+size_t LruCache<Key, Value, Hash, Equal, Alloc>::capacity() const noexcept {
+  return capacity_;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+void LruCache<Key, Value, Hash, Equal, Alloc>::capacity(size_t capacity) {
+  capacity_ = capacity;
+  evict();
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+Value* LruCache<Key, Value, Hash, Equal, Alloc>::get(const Key& key) {
+  auto it = map_.find(key);
+  if (it == map_.end()) {
+    return nullptr;
+  }
+  if (&*it != newest_) {
+    unlink(&*it);
+    push_newest(&*it);
+  }
+  return &it->second.value;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+const Value* LruCache<Key, Value, Hash, Equal, Alloc>::peek(const Key& key) const noexcept {
+  auto it = map_.find(key);
+  return it == map_.end() ? nullptr : &it->second.value;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+bool LruCache<Key, Value, Hash, Equal, Alloc>::contains(const Key& key) const noexcept {
+  return map_.contains(key);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+template<typename V>
+void LruCache<Key, Value, Hash, Equal, Alloc>::put_value(const Key& key, V&& value, size_t charge) {
+  auto it = map_.find(key);
+  if (it == map_.end()) {
+    it = map_.emplace(std::piecewise_construct, std::forward_as_tuple(key),
+                      std::forward_as_tuple(std::forward<V>(value), charge)).first;
+  } else {
+    it->second.value = std::forward<V>(value);
+    charge_ -= it->second.charge;
+    it->second.charge = charge;
+    unlink(&*it);
+  }
+  charge_ += charge;
+  push_newest(&*it);
+  evict();
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+void LruCache<Key, Value, Hash, Equal, Alloc>::put(const Key& key, const Value& value, size_t charge) {
+  put_value(key, value, charge);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+void LruCache<Key, Value, Hash, Equal, Alloc>::put(const Key& key, Value&& value, size_t charge) {
+  put_value(key, std::move(value), charge);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+bool LruCache<Key, Value, Hash, Equal, Alloc>::erase(const Key& key) {
+  auto it = map_.find(key);
+  if (it == map_.end()) {
+    return false;
+  }
+  unlink(&*it);
+  charge_ -= it->second.charge;
+  map_.erase(it);
+  return true;
+}
+
+#endif //UNORDERED_MAP__LRU_CACHE_H_
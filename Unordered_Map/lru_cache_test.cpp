@@ -0,0 +1,80 @@
+#include "lru_cache.h"
+
+#include <cassert>
+#include <string>
+#include <vector>
+
+void TestEntries() {
+    std::vector<int> evicted;
+    LruCache<int, std::string> cache(3, [&evicted](const int& key, std::string& value) {
+        assert(value == std::to_string(key));
+        evicted.push_back(key);
+    });
+    for (int i = 0; i < 3; ++i) {
+        cache.put(i, std::to_string(i));
+    }
+    assert(cache.size() == 3 && evicted.empty());
+
+    // 0 becomes the newest, so 1 goes first.
+    assert(*cache.get(0) == "0");
+    cache.put(3, "3");
+    assert((evicted == std::vector<int>{1}));
+    assert(!cache.contains(1) && cache.get(1) == nullptr);
+
+    // peek does not protect 2.
+    assert(*cache.peek(2) == "2");
+    cache.put(4, "4");
+    assert((evicted == std::vector<int>{1, 2}));
+
+    // Replacing makes the entry the newest as well.
+    cache.put(0, "0");
+    cache.put(5, "5");
+    assert((evicted == std::vector<int>{1, 2, 3}));
+    assert(cache.contains(0) && cache.contains(4) && cache.contains(5));
+
+    assert(cache.erase(4) && !cache.erase(4));
+    assert(cache.size() == 2 && evicted.size() == 3);
+
+    cache.capacity(1);
+    assert((evicted == std::vector<int>{1, 2, 3, 0}));
+    assert(cache.size() == 1 && *cache.get(5) == "5");
+}
+
+void TestCharges() {
+    size_t evicted_bytes = 0;
+    LruCache<std::string, std::string> cache(100, [&evicted_bytes](const std::string&, std::string& value) {
+        evicted_bytes += value.size();
+    });
+    for (int i = 0; i < 10; ++i) {
+        std::string value(20, static_cast<char>('a' + i));
+        cache.put(std::to_string(i), value, value.size());
+    }
+    assert(cache.size() == 5 && cache.charge() == 100 && evicted_bytes == 100);
+    for (int i = 5; i < 10; ++i) {
+        assert(cache.peek(std::to_string(i))->front() == 'a' + i);
+    }
+
+    cache.put("5", std::string(50, 'x'), 50);
+    assert(cache.charge() == 90 && cache.size() == 3 && !cache.contains("6") && !cache.contains("7"));
+
+    // An entry larger than the whole cache does not stay.
+    cache.put("huge", std::string(200, 'h'), 200);
+    assert(cache.size() == 0 && cache.charge() == 0);
+
+    for (int i = 0; i < 10'000; ++i) {
+        cache.put(std::to_string(i % 300), "v", 1);
+        assert(cache.charge() <= 100 && cache.size() == cache.charge());
+    }
+    for (int i = 9'900; i < 10'000; ++i) {
+        assert(cache.contains(std::to_string(i % 300)));
+    }
+}
+
+int main() {
+    std::cerr << "Starting tests" << std::endl;
+    TestEntries();
+    std::cerr << "TestEntries (1 of 2) passed" << std::endl;
+    TestCharges();
+    std::cerr << "TestCharges (2 of 2) passed" << std::endl;
+    std::cout << 0;
+}
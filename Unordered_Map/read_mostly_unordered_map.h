@@ -0,0 +1,356 @@
+#ifndef UNORDERED_MAP__READ_MOSTLY_UNORDERED_MAP_H_
+#define UNORDERED_MAP__READ_MOSTLY_UNORDERED_MAP_H_
+
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+
+#include "unordered_map.h"
+
+// Readers never lock and never issue atomic read-modify-writes: they publish
+// the epoch they entered in their own slot and walk an immutable table. Writers
+// serialise on a mutex, copy the bucket pointer array with one bucket replaced,
+// swap the table pointer and retire the old version; retired versions are freed
+// by later writes once every active reader entered after them.
+template<typename Key, typename Value, typename Hash = std::hash<Key>,
+    typename Equal = std::equal_to<Key>,
+    typename BucketPolicy = ModuloBucketPolicy>
+class ReadMostlyUnorderedMap {
+ public:
+  using node_type = std::pair<const Key, Value>;
+  class Reader;
+
+ private:
+  static const size_t DEFAULT_TABLE_SIZE_ = 64;
+  static const size_t MAX_READERS_ = 128;
+  static const uint64_t IDLE_EPOCH_ = 0;
+
+  using Bucket = std::vector<node_type>;
+
+  struct Table {
+    size_t size;
+    std::vector<const Bucket*> buckets;
+  };
+
+  // A replaced table version; readers that entered at `epoch` or later
+  // cannot see it.
+  struct Retired {
+    uint64_t epoch;
+    const Table* table;
+    const Bucket* bucket;
+    bool all_buckets;
+  };
+
+  struct alignas(64) ReaderSlot {
+    std::atomic<uint64_t> epoch{IDLE_EPOCH_};
+    std::atomic<bool> claimed{false};
+  };
+
+  float max_load_factor_ = 1.0;
+  Hash hasher_ = Hash();
+  Equal key_equal_ = Equal();
+  BucketPolicy bucket_policy_ = BucketPolicy();
+
+  std::atomic<const Table*> table_;
+  std::atomic<uint64_t> epoch_{1};
+  ReaderSlot readers_[MAX_READERS_];
+  mutable std::mutex writer_mutex_;
+  std::vector<Retired> retired_;
+
+  const node_type* find(const Table*, const Key&) const noexcept;
+  Table* rebuild(const Table*, size_t) const;
+  void publish(const Table*, const Bucket*);
+  void reclaim() noexcept;
+  void destroy(const Retired&) noexcept;
+  void replace_bucket(const Table*, size_t, size_t, std::unique_ptr<Bucket>);
+  bool insert_locked(const node_type&);
+
+ public:
+  ReadMostlyUnorderedMap();
+  ReadMostlyUnorderedMap(size_t, const Hash& hasher = Hash(), const Equal& key_equal = Equal());
+  ReadMostlyUnorderedMap(const ReadMostlyUnorderedMap&) = delete;
+  ReadMostlyUnorderedMap& operator=(const ReadMostlyUnorderedMap&) = delete;
+  ~ReadMostlyUnorderedMap() noexcept;
+
+  Reader reader();
+
+  size_t size() const noexcept;
+
+  bool insert(const node_type&);
+  bool insert_or_assign(const node_type&);
+  bool erase(const Key&);
+};
+
+// A registered reader thread; registration is the only read-modify-write.
+template<typename Key, typename Value, typename Hash, typename Equal, typename BucketPolicy>
+class ReadMostlyUnorderedMap<Key, Value, Hash, Equal, BucketPolicy>::Reader {
+ private:
+  const ReadMostlyUnorderedMap* map_;
+  ReaderSlot* slot_;
+
+  Reader(const ReadMostlyUnorderedMap*, ReaderSlot*) noexcept;
+
+  friend class ReadMostlyUnorderedMap;
+
+ public:
+  Reader(const Reader&) = delete;
+  Reader& operator=(const Reader&) = delete;
+  Reader(Reader&&) noexcept;
+  ~Reader() noexcept;
+
+  std::optional<Value> find(const Key&) const;
+  bool contains(const Key&) const noexcept;
+};
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename BucketPolicy>
+ReadMostlyUnorderedMap<Key, Value, Hash, Equal, BucketPolicy>::ReadMostlyUnorderedMap() :
+    ReadMostlyUnorderedMap(DEFAULT_TABLE_SIZE_) {}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename BucketPolicy>
+ReadMostlyUnorderedMap<Key, Value, Hash, Equal, BucketPolicy>::ReadMostlyUnorderedMap(
+    size_t bucket_count, const Hash& hasher, const Equal& key_equal) :
+    hasher_(hasher), key_equal_(key_equal) {
+  table_.store(new Table{0, std::vector<const Bucket*>(bucket_policy_.bucket_count(bucket_count), nullptr)});
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename BucketPolicy>
+ReadMostlyUnorderedMap<Key, Value, Hash, Equal, BucketPolicy>::~ReadMostlyUnorderedMap() noexcept {
+  const Table* table = table_.load();
+  for (const Bucket* bucket : table->buckets) {
+    delete bucket;
+  }
+  delete table;
+  for (auto& version : retired_) {
+    destroy(version);
+  }
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename BucketPolicy>
+typename ReadMostlyUnorderedMap<Key, Value, Hash, Equal, BucketPolicy>::Reader
+ReadMostlyUnorderedMap<Key, Value, Hash, Equal, BucketPolicy>::reader() {
+  for (auto& slot : readers_) {
+    bool expected = false;
+    if (!slot.claimed.load(std::memory_order_relaxed) &&
+        slot.claimed.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+      return Reader(this, &slot);
+    }
+  }
+  throw std::length_error("too many readers");
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename BucketPolicy>
+size_t ReadMostlyUnorderedMap<Key, Value, Hash, Equal, BucketPolicy>::size() const noexcept {
+  std::lock_guard<std::mutex> lock(writer_mutex_);
+  return table_.load(std::memory_order_relaxed)->size;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename BucketPolicy>
+const typename ReadMostlyUnorderedMap<Key, Value, Hash, Equal, BucketPolicy>::node_type*
+ReadMostlyUnorderedMap<Key, Value, Hash, Equal, BucketPolicy>::find(
+    const Table* table, const Key& key) const noexcept {
+  const Bucket* bucket = table->buckets[bucket_policy_(hasher_(key), table->buckets.size())];
+  if (bucket == nullptr) {
+    return nullptr;
+  }
+  for (const node_type& kv : *bucket) {
+    if (key_equal_(key, kv.first)) {
+      return &kv;
+    }
+  }
+  return nullptr;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename BucketPolicy>
+typename ReadMostlyUnorderedMap<Key, Value, Hash, Equal, BucketPolicy>::Table*
+ReadMostlyUnorderedMap<Key, Value, Hash, Equal, BucketPolicy>::rebuild(
+    const Table* table, size_t bucket_count) const {
+  std::vector<std::unique_ptr<Bucket>> buckets(bucket_policy_.bucket_count(bucket_count));
+  for (const Bucket* bucket : table->buckets) {
+    if (bucket == nullptr) {
+      continue;
+    }
+    for (const node_type& kv : *bucket) {
+      auto& new_bucket = buckets[bucket_policy_(hasher_(kv.first), buckets.size())];
+      if (new_bucket == nullptr) {
+        new_bucket.reset(new Bucket());
+      }
+      new_bucket->push_back(kv);
+    }
+  }
+  auto* result = new Table{table->size, std::vector<const Bucket*>(buckets.size(), nullptr)};
+  for (size_t i = 0; i < buckets.size(); ++i) {
+    result->buckets[i] = buckets[i].release();
+  }
+  return result;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename BucketPolicy>
+void ReadMostlyUnorderedMap<Key, Value, Hash, Equal, BucketPolicy>::publish(
+    const Table* table, const Bucket* replaced) {
+  retired_.reserve(retired_.size() + 1);
+  const Table* old_table = table_.exchange(table);
+  bool all_buckets = old_table->buckets.size() != table->buckets.size();
+  retired_.push_back({epoch_.fetch_add(1) + 1, old_table, replaced, all_buckets});
+  reclaim();
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename BucketPolicy>
+void ReadMostlyUnorderedMap<Key, Value, Hash, Equal, BucketPolicy>::reclaim() noexcept {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  uint64_t min_epoch = std::numeric_limits<uint64_t>::max();
+  for (auto& slot : readers_) {
+    uint64_t reader_epoch = slot.epoch.load(std::memory_order_acquire);
+    if (reader_epoch != IDLE_EPOCH_ && reader_epoch < min_epoch) {
+      min_epoch = reader_epoch;
+    }
+  }
+  size_t kept = 0;
+  for (auto& version : retired_) {
+    if (version.epoch <= min_epoch) {
+      destroy(version);
+    } else {
+      retired_[kept++] = version;
+    }
+  }
+  retired_.resize(kept);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename BucketPolicy>
+void ReadMostlyUnorderedMap<Key, Value, Hash, Equal, BucketPolicy>::destroy(const Retired& version) noexcept {
+  if (version.all_buckets) {
+    for (const Bucket* bucket : version.table->buckets) {
+      delete bucket;
+    }
+  } else {
+    delete version.bucket;
+  }
+  delete version.table;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename BucketPolicy>
+void ReadMostlyUnorderedMap<Key, Value, Hash, Equal, BucketPolicy>::replace_bucket(
+    const Table* table, size_t size, size_t index, std::unique_ptr<Bucket> bucket) {
+  if (bucket != nullptr && bucket->empty()) {
+    bucket.reset();
+  }
+  std::unique_ptr<Table> new_table(new Table{size, table->buckets});
+  new_table->buckets[index] = bucket.get();
+  publish(new_table.get(), table->buckets[index]);
+  new_table.release();
+  bucket.release();
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename BucketPolicy>
+bool ReadMostlyUnorderedMap<Key, Value, Hash, Equal, BucketPolicy>::insert(const node_type& kv) {
+  std::lock_guard<std::mutex> lock(writer_mutex_);
+  return insert_locked(kv);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename BucketPolicy>
+bool ReadMostlyUnorderedMap<Key, Value, Hash, Equal, BucketPolicy>::insert_locked(const node_type& kv) {
+  const Table* table = table_.load(std::memory_order_relaxed);
+  if (find(table, kv.first) != nullptr) {
+    return false;
+  }
+  if (static_cast<float>(table->size + 1) > max_load_factor_ * static_cast<float>(table->buckets.size())) {
+    Table* grown = rebuild(table, 2 * table->buckets.size());
+    try {
+      publish(grown, nullptr);
+    } catch (...) {
+      destroy({0, grown, nullptr, true});
+      throw;
+    }
+    table = grown;
+  }
+  size_t index = bucket_policy_(hasher_(kv.first), table->buckets.size());
+  const Bucket* old_bucket = table->buckets[index];
+  std::unique_ptr<Bucket> new_bucket(old_bucket == nullptr ? new Bucket() : new Bucket(*old_bucket));
+  new_bucket->push_back(kv);
+  replace_bucket(table, table->size + 1, index, std::move(new_bucket));
+  return true;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename BucketPolicy>
+bool ReadMostlyUnorderedMap<Key, Value, Hash, Equal, BucketPolicy>::insert_or_assign(const node_type& kv) {
+  std::lock_guard<std::mutex> lock(writer_mutex_);
+  const Table* table = table_.load(std::memory_order_relaxed);
+  if (find(table, kv.first) == nullptr) {
+    return insert_locked(kv);
+  }
+  size_t index = bucket_policy_(hasher_(kv.first), table->buckets.size());
+  std::unique_ptr<Bucket> new_bucket(new Bucket());
+  for (const node_type& old_kv : *table->buckets[index]) {
+    new_bucket->push_back(key_equal_(kv.first, old_kv.first) ? kv : old_kv);
+  }
+  replace_bucket(table, table->size, index, std::move(new_bucket));
+  return false;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename BucketPolicy>
+bool ReadMostlyUnorderedMap<Key, Value, Hash, Equal, BucketPolicy>::erase(const Key& key) {
+  std::lock_guard<std::mutex> lock(writer_mutex_);
+  const Table* table = table_.load(std::memory_order_relaxed);
+  if (find(table, key) == nullptr) {
+    return false;
+  }
+  size_t index = bucket_policy_(hasher_(key), table->buckets.size());
+  std::unique_ptr<Bucket> new_bucket(new Bucket());
+  for (const node_type& kv : *table->buckets[index]) {
+    if (!key_equal_(key, kv.first)) {
+      new_bucket->push_back(kv);
+    }
+  }
+  replace_bucket(table, table->size - 1, index, std::move(new_bucket));
+  return true;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename BucketPolicy>
+ReadMostlyUnorderedMap<Key, Value, Hash, Equal, BucketPolicy>::Reader::Reader(
+    const ReadMostlyUnorderedMap* map, ReaderSlot* slot) noexcept : map_(map), slot_(slot) {}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename BucketPolicy>
+ReadMostlyUnorderedMap<Key, Value, Hash, Equal, BucketPolicy>::Reader::Reader(Reader&& other) noexcept :
+    map_(other.map_), slot_(other.slot_) {
+  other.slot_ = nullptr;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename BucketPolicy>
+ReadMostlyUnorderedMap<Key, Value, Hash, Equal, BucketPolicy>::Reader::~Reader() noexcept {
+  if (slot_ != nullptr) {
+    slot_->claimed.store(false, std::memory_order_release);
+  }
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename BucketPolicy>
+std::optional<Value> ReadMostlyUnorderedMap<Key, Value, Hash, Equal, BucketPolicy>::Reader::find(
+    const Key& key) const {
+  slot_->epoch.store(map_->epoch_.load(std::memory_order_acquire), std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  std::optional<Value> result;
+  try {
+    const node_type* kv = map_->find(map_->table_.load(std::memory_order_acquire), key);
+    if (kv != nullptr) {
+      result.emplace(kv->second);
+    }
+  } catch (...) {
+    slot_->epoch.store(IDLE_EPOCH_, std::memory_order_release);
+    throw;
+  }
+  slot_->epoch.store(IDLE_EPOCH_, std::memory_order_release);
+  return result;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename BucketPolicy>
+bool ReadMostlyUnorderedMap<Key, Value, Hash, Equal, BucketPolicy>::Reader::contains(
+    const Key& key) const noexcept {
+  slot_->epoch.store(map_->epoch_.load(std::memory_order_acquire), std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  bool result = map_->find(map_->table_.load(std::memory_order_acquire), key) != nullptr;
+  slot_->epoch.store(IDLE_EPOCH_, std::memory_order_release);
+  return result;
+}
+
+#endif //UNORDERED_MAP__READ_MOSTLY_UNORDERED_MAP_H_
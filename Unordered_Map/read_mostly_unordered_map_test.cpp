@@ -0,0 +1,81 @@
+#include "read_mostly_unordered_map.h"
+
+#include <cassert>
+#include <string>
+#include <thread>
+#include <vector>
+
+void TestSingleThread() {
+    ReadMostlyUnorderedMap<std::string, int> m;
+    auto reader = m.reader();
+
+    assert(m.insert({"a", 1}));
+    assert(!m.insert({"a", 2}));
+    assert(reader.find("a") == 1);
+    assert(!m.insert_or_assign({"a", 3}));
+    assert(m.insert_or_assign({"b", 4}));
+    assert(reader.find("a") == 3);
+    assert(reader.contains("b"));
+    assert(m.size() == 2);
+
+    for (int i = 0; i < 1000; ++i) {
+        m.insert({std::to_string(i), i});
+    }
+    assert(m.size() == 1002);
+    for (int i = 0; i < 1000; ++i) {
+        assert(reader.find(std::to_string(i)) == i);
+    }
+
+    assert(m.erase("a"));
+    assert(!m.erase("a"));
+    assert(!reader.find("a").has_value());
+    assert(m.size() == 1001);
+}
+
+void TestReadersWithWriter() {
+    const int key_count = 2000;
+    ReadMostlyUnorderedMap<int, int> m;
+    for (int i = 0; i < key_count; i += 2) {
+        m.insert({i, i});
+    }
+
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; ++t) {
+        readers.emplace_back([&m, &stop] {
+            auto reader = m.reader();
+            while (!stop.load()) {
+                for (int i = 0; i < key_count; i += 2) {
+                    auto value = reader.find(i);
+                    assert(value.has_value() && (*value == i || *value == -i));
+                }
+            }
+        });
+    }
+
+    for (int round = 0; round < 3; ++round) {
+        for (int i = 1; i < key_count; i += 2) {
+            m.insert({i, i});
+        }
+        for (int i = 0; i < key_count; i += 2) {
+            m.insert_or_assign({i, round % 2 == 0 ? -i : i});
+        }
+        for (int i = 1; i < key_count; i += 2) {
+            m.erase(i);
+        }
+    }
+    stop.store(true);
+    for (auto& thread : readers) {
+        thread.join();
+    }
+    assert(m.size() == key_count / 2);
+}
+
+int main() {
+    std::cerr << "Starting tests" << std::endl;
+    TestSingleThread();
+    std::cerr << "TestSingleThread (1 of 2) passed" << std::endl;
+    TestReadersWithWriter();
+    std::cerr << "TestReadersWithWriter (2 of 2) passed" << std::endl;
+    std::cout << 0;
+}
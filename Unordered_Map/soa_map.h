@@ -0,0 +1,404 @@
+#ifndef UNORDERED_MAP__SOA_MAP_H_
+#define UNORDERED_MAP__SOA_MAP_H_
+
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#include "unordered_map.h"
+
+// A map whose keys and values live in two separate arrays, position i of
+// one matching position i of the other, so a scan over keys() reads key
+// memory only and can be vectorized; values are fetched for the positions
+// that pass. Lookups go through an open-addressing index of (hash, position)
+// slots, probed linearly. Erasing moves the last entry into the hole, which
+// keeps both arrays dense but changes that entry's position; inserting and
+// erasing invalidate pointers into the arrays.
+template<typename Key, typename Value, typename Hash = std::hash<Key>,
+    typename Equal = std::equal_to<Key>,
+    typename Alloc = std::allocator<std::pair<const Key, Value>>>
+class SoaMap {
+ public:
+  using AllocTraits = std::allocator_traits<Alloc>;
+
+ private:
+  static const size_t MIN_INDEX_COUNT_ = 8;
+  static const size_t EMPTY_ = static_cast<size_t>(-1);
+
+  struct Slot {
+    size_t hash = 0;
+    size_t position = EMPTY_;
+  };
+
+  using KeyAlloc = typename AllocTraits::template rebind_alloc<Key>;
+  using ValueAlloc = typename AllocTraits::template rebind_alloc<Value>;
+  using SlotAlloc = typename AllocTraits::template rebind_alloc<Slot>;
+
+  std::vector<Key, KeyAlloc> keys_;
+  std::vector<Value, ValueAlloc> values_;
+  std::vector<Slot, SlotAlloc> index_;
+  Equal key_equal_;
+  Hash hasher_;
+
+  // The index is at most two thirds full.
+  static size_t usable(size_t) noexcept;
+  size_t get_hash(const Key&) const noexcept;
+  // The slot holding the key, or else the free slot that ends its run; the
+  // index must not be empty.
+  size_t probe(const Key&, size_t) const noexcept;
+  size_t find_slot(const Key&, size_t) const noexcept;
+  void place(size_t, size_t) noexcept;
+  // Backward-shift deletion: later slots of the run move into the hole.
+  void remove_slot(size_t) noexcept;
+  void rehash_index(size_t);
+  template<typename... Args>
+  std::pair<Value*, bool> emplace_value(const Key&, size_t, Args&& ...);
+
+ public:
+  SoaMap();
+  explicit SoaMap(size_t, const Hash& hasher = Hash(), const Equal& key_equal = Equal(),
+                  const Alloc& alloc = Alloc());
+
+  size_t size() const noexcept;
+  bool empty() const noexcept;
+
+  // Parallel arrays of size() elements.
+  const Key* keys() const noexcept;
+  Value* values() noexcept;
+  const Value* values() const noexcept;
+
+  // The value of the key, or nullptr.
+  Value* find(const Key&) noexcept;
+  const Value* find(const Key&) const noexcept;
+  bool contains(const Key&) const noexcept;
+  size_t count(const Key&) const noexcept;
+
+  // Constructs the value from the arguments if the key is not there yet.
+  template<typename... Args>
+  std::pair<Value*, bool> emplace(const Key&, Args&& ...);
+  std::pair<Value*, bool> insert(const Key&, const Value&);
+  std::pair<Value*, bool> insert(const Key&, Value&&);
+  size_t erase(const Key&) noexcept;
+
+  // find() and emplace() with the key's hash computed by the caller, which
+  // must be hash(key): a caller hashing a batch up front hashes every key once.
+  size_t hash(const Key&) const noexcept;
+  Value* find(const Key&, size_t) noexcept;
+  const Value* find(const Key&, size_t) const noexcept;
+  template<typename... Args>
+  std::pair<Value*, bool> emplace_hashed(const Key&, size_t, Args&& ...);
+  // The index slot a lookup of the hash starts at, or nullptr with no index,
+  // for the caller to prefetch. A prefetch inside a member function would not
+  // do: GCC takes such a function for pure and drops calls to it.
+  const void* home_slot(size_t) const noexcept;
+
+  Value& operator[](const Key&);
+  Value& at(const Key&);
+  const Value& at(const Key&) const;
+
+  // Calls function(key, value) for every entry, in array order.
+  template<typename Function>
+  void for_each(Function&&);
+  template<typename Function>
+  void for_each(Function&&) const;
+  // Calls function(key, value, hash) for every entry, in index order.
+  template<typename Function>
+  void for_each_hashed(Function&&) const;
+
+  void reserve(size_t);
+  void clear() noexcept;
+  size_t bucket_count() const noexcept;
+};
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+SoaMap<Key, Value, Hash, Equal, Alloc>::SoaMap() : SoaMap(0) {}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+SoaMap<Key, Value, Hash, Equal, Alloc>::SoaMap(
+    size_t count, const Hash& hasher, const Equal& key_equal, const Alloc& alloc) :
+    keys_(KeyAlloc(alloc)), values_(ValueAlloc(alloc)), index_(SlotAlloc(alloc)),
+    key_equal_(key_equal), hasher_(hasher) {
+  if (count > 0) {
+    reserve(count);
+  }
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+size_t SoaMap<Key, Value, Hash, Equal, Alloc>::usable(size_t index_count) noexcept {
+  return index_count * 2 / 3;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+size_t SoaMap<Key, Value, Hash, Equal, Alloc>::get_hash(const Key& key) const noexcept {
+  return mix_hash(hasher_(key));
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+size_t SoaMap<Key, Value, Hash, Equal, Alloc>::probe(const Key& key, size_t hash) const noexcept {
+  size_t mask = index_.size() - 1;
+  size_t slot = hash & mask;
+  for (; index_[slot].position != EMPTY_; slot = (slot + 1) & mask) {
+    const Slot& candidate = index_[slot];
+    if (candidate.hash == hash && key_equal_(keys_[candidate.position], key)) {
+      break;
+    }
+  }
+  return slot;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+size_t SoaMap<Key, Value, Hash, Equal, Alloc>::find_slot(const Key& key, size_t hash) const noexcept {
+  if (index_.empty()) {
+    return EMPTY_;
+  }
+  size_t slot = probe(key, hash);
+  return index_[slot].position == EMPTY_ ? EMPTY_ : slot;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+void SoaMap<Key, Value, Hash, Equal, Alloc>::place(size_t hash, size_t position) noexcept {
+  size_t mask = index_.size() - 1;
+  size_t slot = hash & mask;
+  while (index_[slot].position != EMPTY_) {
+    slot = (slot + 1) & mask;
+  }
+  index_[slot].hash = hash;
+  index_[slot].position = position;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+void SoaMap<Key, Value, Hash, Equal, Alloc>::remove_slot(size_t hole) noexcept {
+  size_t mask = index_.size() - 1;
+  for (size_t next = (hole + 1) & mask; index_[next].position != EMPTY_; next = (next + 1) & mask) {
+    size_t home = index_[next].hash & mask;
+    // The slot may move back unless its home lies after the hole.
+    if (((next - home) & mask) >= ((next - hole) & mask)) {
+      index_[hole] = index_[next];
+      hole = next;
+    }
+  }
+  index_[hole].position = EMPTY_;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+void SoaMap<Key, Value, Hash, Equal, Alloc>::rehash_index(size_t index_count) {
+  std::vector<Slot, SlotAlloc> index(index_count, Slot(), index_.get_allocator());
+  index.swap(index_);
+  for (const Slot& slot : index) {
+    if (slot.position != EMPTY_) {
+      place(slot.hash, slot.position);
+    }
+  }
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+template<typename... Args>
+std::pair<Value*, bool> SoaMap<Key, Value, Hash, Equal, Alloc>::emplace_value(
+    const Key& key, size_t hash, Args&& ... args) {
+  // Growing first leaves one probe to find either the key or its free slot.
+  if (keys_.size() + 1 > usable(index_.size())) {
+    rehash_index(std::max(size_t(MIN_INDEX_COUNT_), 2 * index_.size()));
+  }
+  size_t slot = probe(key, hash);
+  if (index_[slot].position != EMPTY_) {
+    return {&values_[index_[slot].position], false};
+  }
+  keys_.push_back(key);
+  try {
+    values_.emplace_back(std::forward<Args>(args)...);
+  } catch (...) {
+    keys_.pop_back();
+    throw;
+  }
+  index_[slot].hash = hash;
+  index_[slot].position = keys_.size() - 1;
+  return {&values_.back(), true};
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+size_t SoaMap<Key, Value, Hash, Equal, Alloc>::size() const noexcept {
+  return keys_.size();
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+bool SoaMap<Key, Value, Hash, Equal, Alloc>::empty() const noexcept {
+  return keys_.empty();
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+const Key* SoaMap<Key, Value, Hash, Equal, Alloc>::keys() const noexcept {
+  return keys_.data();
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+Value* SoaMap<Key, Value, Hash, Equal, Alloc>::values() noexcept {
+  return values_.data();
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+const Value* SoaMap<Key, Value, Hash, Equal, Alloc>::values() const noexcept {
+  return values_.data();
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+Value* SoaMap<Key, Value, Hash, Equal, Alloc>::find(const Key& key) noexcept {
+  return find(key, get_hash(key));
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+const Value* SoaMap<Key, Value, Hash, Equal, Alloc>::find(const Key& key) const noexcept {
+  return const_cast<SoaMap*>(this)->find(key);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+bool SoaMap<Key, Value, Hash, Equal, Alloc>::contains(const Key& key) const noexcept {
+  return find_slot(key, get_hash(key)) != EMPTY_;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+size_t SoaMap<Key, Value, Hash, Equal, Alloc>::count(const Key& key) const noexcept {
+  return contains(key) ? 1 : 0;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+template<typename... Args>
+std::pair<Value*, bool> SoaMap<Key, Value, Hash, Equal, Alloc>::emplace(const Key& key, Args&& ... args) {
+  return emplace_value(key, get_hash(key), std::forward<Args>(args)...);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+std::pair<Value*, bool> SoaMap<Key, Value, Hash, Equal, Alloc>::insert(const Key& key, const Value& value) {
+  return emplace_value(key, get_hash(key), value);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+std::pair<Value*, bool> SoaMap<Key, Value, Hash, Equal, Alloc>::insert(const Key& key, Value&& value) {
+  return emplace_value(key, get_hash(key), std::move(value));
+}
+
+// The last entry takes the erased one's position; its slot is found by
+// probing for that position under its own hash.
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+size_t SoaMap<Key, Value, Hash, Equal, Alloc>::erase(const Key& key) noexcept {
+  size_t slot = find_slot(key, get_hash(key));
+  if (slot == EMPTY_) {
+    return 0;
+  }
+  size_t position = index_[slot].position;
+  remove_slot(slot);
+  size_t last = keys_.size() - 1;
+  if (position != last) {
+    size_t mask = index_.size() - 1;
+    size_t moved = get_hash(keys_[last]) & mask;
+    while (index_[moved].position != last) {
+      moved = (moved + 1) & mask;
+    }
+    index_[moved].position = position;
+    keys_[position] = std::move(keys_[last]);
+    values_[position] = std::move(values_[last]);
+  }
+  keys_.pop_back();
+  values_.pop_back();
+  return 1;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+size_t SoaMap<Key, Value, Hash, Equal, Alloc>::hash(const Key& key) const noexcept {
+  return get_hash(key);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+Value* SoaMap<Key, Value, Hash, Equal, Alloc>::find(const Key& key, size_t hash) noexcept {
+  size_t slot = find_slot(key, hash);
+  return slot == EMPTY_ ? nullptr : &values_[index_[slot].position];
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+const Value* SoaMap<Key, Value, Hash, Equal, Alloc>::find(const Key& key, size_t hash) const noexcept {
+  return const_cast<SoaMap*>(this)->find(key, hash);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+template<typename... Args>
+std::pair<Value*, bool> SoaMap<Key, Value, Hash, Equal, Alloc>::emplace_hashed(
+    const Key& key, size_t hash, Args&& ... args) {
+  return emplace_value(key, hash, std::forward<Args>(args)...);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+const void* SoaMap<Key, Value, Hash, Equal, Alloc>::home_slot(size_t hash) const noexcept {
+  return index_.empty() ? nullptr : &index_[hash & (index_.size() - 1)];
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+Value& SoaMap<Key, Value, Hash, Equal, Alloc>::operator[](const Key& key) {
+  return *emplace_value(key, get_hash(key)).first;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+Value& SoaMap<Key, Value, Hash, Equal, Alloc>::at(const Key& key) {
+  Value* value = find(key);
+  if (value == nullptr) {
+    throw std::range_error("key does not exist");
+  }
+  return *value;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+const Value& SoaMap<Key, Value, Hash, Equal, Alloc>::at(const Key& key) const {
+  return const_cast<SoaMap*>(this)->at(key);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+template<typename Function>
+void SoaMap<Key, Value, Hash, Equal, Alloc>::for_each(Function&& function) {
+  for (size_t i = 0; i < keys_.size(); ++i) {
+    function(static_cast<const Key&>(keys_[i]), values_[i]);
+  }
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+template<typename Function>
+void SoaMap<Key, Value, Hash, Equal, Alloc>::for_each(Function&& function) const {
+  for (size_t i = 0; i < keys_.size(); ++i) {
+    function(keys_[i], values_[i]);
+  }
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+template<typename Function>
+void SoaMap<Key, Value, Hash, Equal, Alloc>::for_each_hashed(Function&& function) const {
+  for (const Slot& slot : index_) {
+    if (slot.position != EMPTY_) {
+      function(keys_[slot.position], values_[slot.position], slot.hash);
+    }
+  }
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+void SoaMap<Key, Value, Hash, Equal, Alloc>::reserve(size_t count) {
+  size_t index_count = std::max(size_t(MIN_INDEX_COUNT_), index_.size());
+  while (usable(index_count) < count) {
+    index_count *= 2;
+  }
+  if (index_count != index_.size()) {
+    rehash_index(index_count);
+  }
+  keys_.reserve(count);
+  values_.reserve(count);
+}
+
+// Frees the index too; the next insert allocates a new one.
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+void SoaMap<Key, Value, Hash, Equal, Alloc>::clear() noexcept {
+  keys_.clear();
+  values_.clear();
+  std::vector<Slot, SlotAlloc>(index_.get_allocator()).swap(index_);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+size_t SoaMap<Key, Value, Hash, Equal, Alloc>::bucket_count() const noexcept {
+  return index_.size();
+}
+
+#endif //UNORDERED_MAP__SOA_MAP_H_
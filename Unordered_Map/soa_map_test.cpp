@@ -0,0 +1,108 @@
+#include "soa_map.h"
+
+#include <cassert>
+#include <random>
+#include <string>
+
+void TestBasics() {
+    SoaMap<std::string, int> m;
+    assert(m.empty() && m.find("a") == nullptr);
+    assert(m.insert("a", 1).second && !m.insert("a", 2).second);
+    assert(m.emplace("b", 2).second);
+    m["c"] = 3;
+    assert(m.size() == 3 && m.at("a") == 1 && *m.find("b") == 2 && m.count("d") == 0);
+
+    bool thrown = false;
+    try {
+        m.at("d");
+    } catch (const std::range_error&) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    // The arrays stay parallel, and the last entry fills an erased position.
+    for (size_t i = 0; i < m.size(); ++i) {
+        assert(m.at(m.keys()[i]) == m.values()[i]);
+    }
+    assert(m.erase("a") == 1 && m.erase("a") == 0);
+    assert(m.size() == 2 && m.keys()[0] == "c" && m.values()[0] == 3);
+
+    int sum = 0;
+    m.for_each([&sum](const std::string& key, int& value) {
+        value *= 10;
+        sum += static_cast<int>(key.size());
+    });
+    assert(sum == 2 && m.at("b") == 20 && m.at("c") == 30);
+
+    SoaMap<std::string, int> copy = m;
+    copy["d"] = 4;
+    SoaMap<std::string, int> moved = std::move(copy);
+    assert(moved.size() == 3 && m.size() == 2 && moved.at("c") == 30);
+    m = moved;
+    assert(m.size() == 3 && m.at("d") == 4);
+
+    // A caller-computed hash finds and inserts like the key itself would.
+    size_t hash = m.hash("e");
+    assert(m.home_slot(hash) != nullptr && (SoaMap<std::string, int>().home_slot(hash) == nullptr));
+    assert(m.find("e", hash) == nullptr && m.emplace_hashed("e", hash, 5).second);
+    assert(m.at("e") == 5 && *m.find("c", m.hash("c")) == 30);
+    size_t visited = 0;
+    m.for_each_hashed([&](const std::string& key, int value, size_t stored) {
+        assert(stored == m.hash(key) && m.at(key) == value);
+        ++visited;
+    });
+    assert(visited == 4);
+    m.clear();
+    assert(m.empty() && !m.contains("e") && m.bucket_count() == 0);
+    m["f"] = 6;
+    assert(m.size() == 1 && m.at("f") == 6);
+}
+
+// Random inserts and erases against UnorderedMap, then a filtered scan.
+void TestAgainstUnorderedMap() {
+    SoaMap<int, int> m;
+    UnorderedMap<int, int> reference;
+    std::mt19937 gen(5);
+    for (int i = 0; i < 200'000; ++i) {
+        int key = static_cast<int>(gen() % 30'000);
+        if (gen() % 3 == 0) {
+            assert(m.erase(key) == reference.erase(key));
+        } else {
+            assert(m.insert(key, i).second == reference.emplace(key, i).second);
+        }
+    }
+    assert(m.size() == reference.size());
+    for (int key = 0; key < 30'000; ++key) {
+        assert(m.contains(key) == reference.contains(key));
+    }
+
+    long long expected = 0;
+    for (const auto& kv : reference) {
+        if (kv.first % 7 == 0) {
+            expected += kv.second;
+        }
+    }
+    long long filtered = 0;
+    for (size_t i = 0; i < m.size(); ++i) {
+        if (m.keys()[i] % 7 == 0) {
+            filtered += m.values()[i];
+        }
+    }
+    assert(filtered == expected);
+
+    SoaMap<int, int> reserved(1000);
+    size_t buckets = reserved.bucket_count();
+    for (int i = 0; i < 1000; ++i) {
+        reserved[i] = i;
+    }
+    assert(reserved.bucket_count() == buckets && reserved.at(999) == 999);
+}
+
+int main() {
+    std::cerr << "Starting tests" << std::endl;
+    TestBasics();
+    std::cerr << "TestBasics (1 of 2) passed" << std::endl;
+    TestAgainstUnorderedMap();
+    std::cerr << "TestAgainstUnorderedMap (2 of 2) passed" << std::endl;
+    std::cout << 0;
+}
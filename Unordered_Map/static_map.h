@@ -0,0 +1,197 @@
+#ifndef UNORDERED_MAP__STATIC_MAP_H_
+#define UNORDERED_MAP__STATIC_MAP_H_
+
+#include <array>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+
+#include "unordered_map.h"
+
+// constexpr hashes for StaticMap: integers hash to themselves, strings with
+// 64-bit FNV-1a. StaticMap mixes the result, so neither needs to be strong.
+template<typename Key, typename = void>
+struct StaticHash;
+
+template<typename Key>
+struct StaticHash<Key, std::enable_if_t<std::is_integral_v<Key> || std::is_enum_v<Key>>> {
+  constexpr size_t operator()(Key key) const noexcept {
+    return static_cast<size_t>(key);
+  }
+};
+
+template<>
+struct StaticHash<std::string_view> {
+  constexpr size_t operator()(std::string_view key) const noexcept {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (char c : key) {
+      hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3ULL;
+    }
+    return static_cast<size_t>(hash);
+  }
+};
+
+// A minimal perfect hash table over a fixed key set, built by hash and
+// displace: keys are grouped into N buckets, and largest buckets first, each
+// bucket gets the first seed that sends all its keys to free slots. A lookup
+// hashes the key once and probes exactly one slot.
+template<typename Key, typename Value, size_t N, typename Hash = StaticHash<Key>,
+    typename Equal = std::equal_to<Key>>
+class StaticMap {
+  static_assert(N > 0, "StaticMap needs at least one key");
+
+ public:
+  struct node_type {
+    Key first;
+    Value second;
+  };
+  using const_iterator = const node_type*;
+
+ private:
+  static const uint32_t MAX_SEED_ = 1 << 20;
+
+  std::array<node_type, N> nodes_{};
+  std::array<uint32_t, N> seeds_{};
+  Equal key_equal_ = Equal();
+  Hash hasher_ = Hash();
+
+  // Both take the mixed hash; the slot re-multiplies it with the seed folded in.
+  static constexpr size_t reduce(size_t hash) noexcept;
+  static constexpr size_t get_bucket(size_t hash) noexcept;
+  static constexpr size_t get_slot(size_t hash, uint32_t seed) noexcept;
+
+ public:
+  constexpr explicit StaticMap(const node_type (&)[N], const Hash& hasher = Hash(),
+                               const Equal& key_equal = Equal());
+
+  constexpr size_t size() const noexcept;
+
+  constexpr const_iterator find(const Key&) const noexcept;
+  constexpr bool contains(const Key&) const noexcept;
+  constexpr const Value& at(const Key&) const;
+
+  constexpr const_iterator begin() const noexcept;
+  constexpr const_iterator end() const noexcept;
+};
+
+template<typename Key, typename Value, size_t N>
+constexpr StaticMap<Key, Value, N> make_static_map(
+    const typename StaticMap<Key, Value, N>::node_type (&nodes)[N]) {
+  return StaticMap<Key, Value, N>(nodes);
+}
+
+template<typename Key, typename Value, size_t N, typename Hash, typename Equal>
+constexpr size_t StaticMap<Key, Value, N, Hash, Equal>::reduce(size_t hash) noexcept {
+  return static_cast<size_t>((static_cast<unsigned __int128>(hash) * N) >> 64);
+}
+
+template<typename Key, typename Value, size_t N, typename Hash, typename Equal>
+constexpr size_t StaticMap<Key, Value, N, Hash, Equal>::get_bucket(size_t hash) noexcept {
+  return reduce(hash);
+}
+
+template<typename Key, typename Value, size_t N, typename Hash, typename Equal>
+constexpr size_t StaticMap<Key, Value, N, Hash, Equal>::get_slot(size_t hash, uint32_t seed) noexcept {
+  return reduce((hash ^ seed * 0x9e3779b97f4a7c15ULL) * 0xc4ceb9fe1a85ec53ULL);
+}
+
+template<typename Key, typename Value, size_t N, typename Hash, typename Equal>
+constexpr StaticMap<Key, Value, N, Hash, Equal>::StaticMap(
+    const node_type (&nodes)[N], const Hash& hasher, const Equal& key_equal) :
+    key_equal_(key_equal), hasher_(hasher) {
+  // Group node indices by bucket, CSR style.
+  std::array<size_t, N> hashes{};
+  std::array<size_t, N + 1> starts{};
+  for (size_t i = 0; i < N; ++i) {
+    hashes[i] = mix_hash(hasher_(nodes[i].first));
+    ++starts[get_bucket(hashes[i]) + 1];
+  }
+  size_t max_bucket_size = 0;
+  for (size_t i = 0; i < N; ++i) {
+    max_bucket_size = std::max(max_bucket_size, starts[i + 1]);
+    starts[i + 1] += starts[i];
+  }
+  std::array<size_t, N> members{};
+  std::array<size_t, N> positions{};
+  for (size_t i = 0; i < N; ++i) {
+    positions[i] = starts[i];
+  }
+  for (size_t i = 0; i < N; ++i) {
+    members[positions[get_bucket(hashes[i])]++] = i;
+  }
+
+  std::array<bool, N> used{};
+  std::array<size_t, N> slots{};
+  for (size_t bucket_size = max_bucket_size; bucket_size > 0; --bucket_size) {
+    for (size_t bucket = 0; bucket < N; ++bucket) {
+      if (starts[bucket + 1] - starts[bucket] != bucket_size) {
+        continue;
+      }
+      for (uint32_t seed = 1;; ++seed) {
+        if (seed == MAX_SEED_) {
+          throw std::logic_error("no perfect hash found: keys with equal hashes");
+        }
+        bool placed = true;
+        for (size_t i = starts[bucket]; i < starts[bucket + 1] && placed; ++i) {
+          slots[i] = get_slot(hashes[members[i]], seed);
+          placed = !used[slots[i]];
+          for (size_t j = starts[bucket]; j < i && placed; ++j) {
+            if (key_equal_(nodes[members[i]].first, nodes[members[j]].first)) {
+              throw std::invalid_argument("duplicate key");
+            }
+            placed = slots[i] != slots[j];
+          }
+        }
+        if (placed) {
+          for (size_t i = starts[bucket]; i < starts[bucket + 1]; ++i) {
+            used[slots[i]] = true;
+            nodes_[slots[i]] = nodes[members[i]];
+          }
+          seeds_[bucket] = seed;
+          break;
+        }
+      }
+    }
+  }
+}
+
+template<typename Key, typename Value, size_t N, typename Hash, typename Equal>
+constexpr size_t StaticMap<Key, Value, N, Hash, Equal>::size() const noexcept {
+  return N;
+}
+
+template<typename Key, typename Value, size_t N, typename Hash, typename Equal>
+constexpr typename StaticMap<Key, Value, N, Hash, Equal>::const_iterator
+StaticMap<Key, Value, N, Hash, Equal>::find(const Key& key) const noexcept {
+  size_t hash = mix_hash(hasher_(key));
+  size_t slot = get_slot(hash, seeds_[get_bucket(hash)]);
+  return key_equal_(nodes_[slot].first, key) ? nodes_.data() + slot : end();
+}
+
+template<typename Key, typename Value, size_t N, typename Hash, typename Equal>
+constexpr bool StaticMap<Key, Value, N, Hash, Equal>::contains(const Key& key) const noexcept {
+  return find(key) != end();
+}
+
+template<typename Key, typename Value, size_t N, typename Hash, typename Equal>
+constexpr const Value& StaticMap<Key, Value, N, Hash, Equal>::at(const Key& key) const {
+  auto pos = find(key);
+  if (pos == end()) {
+    throw std::range_error("key does not exist");
+  }
+  return pos->second;
+}
+
+template<typename Key, typename Value, size_t N, typename Hash, typename Equal>
+constexpr typename StaticMap<Key, Value, N, Hash, Equal>::const_iterator
+StaticMap<Key, Value, N, Hash, Equal>::begin() const noexcept {
+  return nodes_.data();
+}
+
+template<typename Key, typename Value, size_t N, typename Hash, typename Equal>
+constexpr typename StaticMap<Key, Value, N, Hash, Equal>::const_iterator
+StaticMap<Key, Value, N, Hash, Equal>::end() const noexcept {
+  return nodes_.data() + N;
+}
+
+#endif //UNORDERED_MAP__STATIC_MAP_H_
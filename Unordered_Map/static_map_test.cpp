@@ -0,0 +1,74 @@
+#include "static_map.h"
+
+#include <cassert>
+#include <string>
+
+constexpr auto kMethods = make_static_map<std::string_view, int>({
+    {"GET", 1}, {"HEAD", 2}, {"POST", 3}, {"PUT", 4}, {"DELETE", 5},
+    {"CONNECT", 6}, {"OPTIONS", 7}, {"TRACE", 8}, {"PATCH", 9},
+});
+
+static_assert(kMethods.size() == 9);
+static_assert(kMethods.at("PATCH") == 9);
+static_assert(kMethods.contains("GET") && !kMethods.contains("get") && !kMethods.contains(""));
+
+enum class Color {
+    kRed = 10, kGreen = 200, kBlue = 3000,
+};
+
+constexpr auto kColorNames = make_static_map<Color, std::string_view>({
+    {Color::kRed, "red"}, {Color::kGreen, "green"}, {Color::kBlue, "blue"},
+});
+
+static_assert(kColorNames.at(Color::kGreen) == "green");
+
+void TestStrings() {
+    std::string method = "DELETE";
+    assert(kMethods.at(method) == 5);
+    assert(kMethods.find(std::string("PUT"))->second == 4);
+    assert(kMethods.find("put") == kMethods.end());
+
+    bool thrown = false;
+    try {
+        kMethods.at("BREW");
+    } catch (const std::range_error&) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    int sum = 0;
+    for (const auto& kv : kMethods) {
+        assert(kMethods.at(kv.first) == kv.second);
+        sum += kv.second;
+    }
+    assert(sum == 45);
+}
+
+template<size_t... Is>
+constexpr auto MakeSquares(std::index_sequence<Is...>) {
+    return make_static_map<int, int>({{static_cast<int>(Is * Is), static_cast<int>(Is)}...});
+}
+
+void TestIntegers() {
+    constexpr auto squares = MakeSquares(std::make_index_sequence<500>());
+    static_assert(squares.at(499 * 499) == 499);
+    for (int i = 0; i < 500 * 500; ++i) {
+        auto it = squares.find(i);
+        int root = 0;
+        while (root * root < i) {
+            ++root;
+        }
+        assert((it != squares.end()) == (root * root == i));
+        assert(it == squares.end() || it->second == root);
+    }
+    assert(kColorNames.at(Color::kBlue) == "blue");
+}
+
+int main() {
+    std::cerr << "Starting tests" << std::endl;
+    TestStrings();
+    std::cerr << "TestStrings (1 of 2) passed" << std::endl;
+    TestIntegers();
+    std::cerr << "TestIntegers (2 of 2) passed" << std::endl;
+    std::cout << 0;
+}
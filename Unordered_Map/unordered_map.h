@@ -1,7 +1,28 @@
+#ifndef UNORDERED_MAP__UNORDERED_MAP_H_
+#define UNORDERED_MAP__UNORDERED_MAP_H_
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <exception>
 #include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <thread>
 #include <vector>
 
-template<typename T, typename Allocator = std::allocator<T>>
+// A list built with CacheHash gives each node room for a hash code of its
+// value; the list itself never reads it.
+template<bool CacheHash>
+struct ListHashCode {};
+
+template<>
+struct ListHashCode<true> {
+  size_t hash_code = 0;
+};
+
+template<typename T, typename Allocator = std::allocator<T>, bool CacheHash = false>
 class List {
  private:
   template<bool is_const>
@@ -25,7 +46,7 @@ class List {
 
   BaseNode* ptr_on_fake_node_ = nullptr;
 
-  struct Node : BaseNode {
+  struct Node : BaseNode, ListHashCode<CacheHash> {
     T* ptr_on_value;
     Node() = default;
 
@@ -48,16 +69,31 @@ class List {
   template<typename... Args>
   iterator emplace(const_iterator, Args&& ...);
 
-  void swap_alloc(List<T, Allocator>&) noexcept;
+  void swap_alloc(List<T, Allocator, CacheHash>&) noexcept;
 
-  void move_alloc(List<T, Allocator>&) noexcept;
-  void move_data(List<T, Allocator>&) noexcept;
+  void move_alloc(List<T, Allocator, CacheHash>&) noexcept;
+  void move_data(List<T, Allocator, CacheHash>&) noexcept;
 
  public:
-  void swap_data(List<T, Allocator>&) noexcept;
+  void swap_data(List<T, Allocator, CacheHash>&) noexcept;
 
   void delete_elements() noexcept;
   void delete_node(const iterator&) noexcept;
+  void splice(const_iterator, const_iterator) noexcept;
+  // unlink() takes a node out of the list without freeing it; link() puts
+  // such a node back before pos, and free_node() releases it and its value.
+  iterator unlink(const_iterator) noexcept;
+  iterator link(const_iterator, iterator) noexcept;
+  static void free_node(iterator, const Allocator&) noexcept;
+  // Bulk building: make_node() allocates an unlinked node, chain() links two
+  // unlinked nodes, and assign_chain() makes [first, last] the whole list.
+  // The list is inconsistent until assign_chain() has been called.
+  iterator make_node(T*);
+  static void chain(iterator, iterator) noexcept;
+  void assign_chain(iterator, iterator, size_t) noexcept;
+  // The hash code stored in a node, linked or not; needs CacheHash.
+  static size_t hash_code(const_iterator) noexcept;
+  static void hash_code(iterator, size_t) noexcept;
   void clear() noexcept;
 
   List(const Allocator& alloc = Allocator()) noexcept;
@@ -98,8 +134,8 @@ class List {
   const_iterator cend() const noexcept;
 };
 
-template<typename T, typename Allocator>
-List<T, Allocator>::List(const Allocator& alloc) noexcept:
+template<typename T, typename Allocator, bool CacheHash>
+List<T, Allocator, CacheHash>::List(const Allocator& alloc) noexcept:
     base_node_allocator_(alloc), node_allocator_(alloc) {
   ptr_on_fake_node_ = BaseNodeTraits::allocate(base_node_allocator_, 1);
   try {
@@ -110,8 +146,8 @@ List<T, Allocator>::List(const Allocator& alloc) noexcept:
   }
 }
 
-template<typename T, typename Allocator>
-List<T, Allocator>::List(size_t size, const Allocator& alloc) : List<T, Allocator>(alloc) {
+template<typename T, typename Allocator, bool CacheHash>
+List<T, Allocator, CacheHash>::List(size_t size, const Allocator& alloc) : List<T, Allocator, CacheHash>(alloc) {
   try {
     while (size-- > 0) {
       emplace(end());
@@ -122,9 +158,9 @@ List<T, Allocator>::List(size_t size, const Allocator& alloc) : List<T, Allocato
   }
 }
 
-template<typename T, typename Allocator>
-List<T, Allocator>::List(size_t size, const T& value, const Allocator& alloc)
-    : List<T, Allocator>(alloc) {
+template<typename T, typename Allocator, bool CacheHash>
+List<T, Allocator, CacheHash>::List(size_t size, const T& value, const Allocator& alloc)
+    : List<T, Allocator, CacheHash>(alloc) {
   while (size-- > 0) {
     try {
       push_back(value);
@@ -135,8 +171,8 @@ List<T, Allocator>::List(size_t size, const T& value, const Allocator& alloc)
   }
 }
 
-template<typename T, typename Allocator>
-void List<T, Allocator>::add_elements(const List<T, Allocator>& arg_list) {
+template<typename T, typename Allocator, bool CacheHash>
+void List<T, Allocator, CacheHash>::add_elements(const List<T, Allocator, CacheHash>& arg_list) {
   for (auto it = arg_list.begin(); it != arg_list.end(); ++it) {
     try {
       push_back(*it);
@@ -147,15 +183,15 @@ void List<T, Allocator>::add_elements(const List<T, Allocator>& arg_list) {
   }
 }
 
-template<typename T, typename Allocator>
-void List<T, Allocator>::delete_elements() noexcept {
+template<typename T, typename Allocator, bool CacheHash>
+void List<T, Allocator, CacheHash>::delete_elements() noexcept {
   while (size_ > 0) {
     pop_back();
   }
 }
 
-template<typename T, typename Allocator>
-void List<T, Allocator>::delete_node(const iterator& iter) noexcept {
+template<typename T, typename Allocator, bool CacheHash>
+void List<T, Allocator, CacheHash>::delete_node(const iterator& iter) noexcept {
   BaseNode* node_to_delete = iter.get_node();
   BaseNode* prev = node_to_delete->prev;
   BaseNode* next = node_to_delete->next;
@@ -167,59 +203,151 @@ void List<T, Allocator>::delete_node(const iterator& iter) noexcept {
   --size_;
 }
 
-template<typename T, typename Allocator>
-List<T, Allocator>::List(const List& other_list) :
+template<typename T, typename Allocator, bool CacheHash>
+void List<T, Allocator, CacheHash>::splice(const_iterator pos, const_iterator iter) noexcept {
+  BaseNode* node = iter.get_node();
+  BaseNode* next = pos.get_node();
+  if (node == next || node->next == next) {
+    return;
+  }
+  node->prev->next = node->next;
+  node->next->prev = node->prev;
+  BaseNode* prev = next->prev;
+  node->prev = prev;
+  node->next = next;
+  prev->next = node;
+  next->prev = node;
+}
+
+template<typename T, typename Allocator, bool CacheHash>
+typename List<T, Allocator, CacheHash>::iterator List<T, Allocator, CacheHash>::unlink(const_iterator iter) noexcept {
+  BaseNode* node = iter.get_node();
+  node->prev->next = node->next;
+  node->next->prev = node->prev;
+  node->prev = node->next = node;
+  --size_;
+  return iterator(node);
+}
+
+template<typename T, typename Allocator, bool CacheHash>
+typename List<T, Allocator, CacheHash>::iterator List<T, Allocator, CacheHash>::link(
+    const_iterator pos, iterator iter) noexcept {
+  BaseNode* node = iter.get_node();
+  BaseNode* next = pos.get_node();
+  BaseNode* prev = next->prev;
+  node->prev = prev;
+  node->next = next;
+  prev->next = node;
+  next->prev = node;
+  ++size_;
+  return iter;
+}
+
+template<typename T, typename Allocator, bool CacheHash>
+void List<T, Allocator, CacheHash>::free_node(iterator iter, const Allocator& alloc) noexcept {
+  auto value_alloc = alloc;
+  AllocTraits::destroy(value_alloc, iter.operator->());
+  AllocTraits::deallocate(value_alloc, iter.operator->(), 1);
+
+  NodeAlloc node_alloc(alloc);
+  NodeTraits::destroy(node_alloc, reinterpret_cast<Node*>(iter.get_node()));
+  NodeTraits::deallocate(node_alloc, reinterpret_cast<Node*>(iter.get_node()), 1);
+}
+
+template<typename T, typename Allocator, bool CacheHash>
+typename List<T, Allocator, CacheHash>::iterator List<T, Allocator, CacheHash>::make_node(T* ptr_on_value) {
+  Node* ptr = NodeTraits::allocate(node_allocator_, 1);
+  try {
+    NodeTraits::construct(node_allocator_, ptr, ptr_on_value);
+  } catch (...) {
+    NodeTraits::deallocate(node_allocator_, ptr, 1);
+    throw;
+  }
+  auto node = reinterpret_cast<BaseNode*>(ptr);
+  node->prev = node->next = node;
+  return iterator(node);
+}
+
+template<typename T, typename Allocator, bool CacheHash>
+void List<T, Allocator, CacheHash>::chain(iterator prev, iterator next) noexcept {
+  prev.get_node()->next = next.get_node();
+  next.get_node()->prev = prev.get_node();
+}
+
+template<typename T, typename Allocator, bool CacheHash>
+void List<T, Allocator, CacheHash>::assign_chain(iterator first, iterator last, size_t size) noexcept {
+  if (size == 0) {
+    ptr_on_fake_node_->prev = ptr_on_fake_node_->next = ptr_on_fake_node_;
+  } else {
+    chain(iterator(ptr_on_fake_node_), first);
+    chain(last, iterator(ptr_on_fake_node_));
+  }
+  size_ = size;
+}
+
+template<typename T, typename Allocator, bool CacheHash>
+size_t List<T, Allocator, CacheHash>::hash_code(const_iterator iter) noexcept {
+  return static_cast<const Node*>(iter.get_node())->hash_code;
+}
+
+template<typename T, typename Allocator, bool CacheHash>
+void List<T, Allocator, CacheHash>::hash_code(iterator iter, size_t hash) noexcept {
+  static_cast<Node*>(iter.get_node())->hash_code = hash;
+}
+
+template<typename T, typename Allocator, bool CacheHash>
+List<T, Allocator, CacheHash>::List(const List& other_list) :
     List(NodeTraits::select_on_container_copy_construction(other_list.get_allocator())) {
   add_elements(other_list);
 }
 
-template<typename T, typename Allocator>
-List<T, Allocator>::List(List&& other_list) noexcept:
+template<typename T, typename Allocator, bool CacheHash>
+List<T, Allocator, CacheHash>::List(List&& other_list) noexcept:
     List(std::move(NodeTraits::select_on_container_copy_construction(other_list.get_allocator()))) {
   swap_data(other_list);
 }
 
-template<typename T, typename Allocator>
-void List<T, Allocator>::clear() noexcept {
+template<typename T, typename Allocator, bool CacheHash>
+void List<T, Allocator, CacheHash>::clear() noexcept {
   delete_elements();
   BaseNodeTraits::destroy(base_node_allocator_, ptr_on_fake_node_);
   BaseNodeTraits::deallocate(base_node_allocator_, ptr_on_fake_node_, 1);
 }
 
-template<typename T, typename Allocator>
-List<T, Allocator>::~List() noexcept {
+template<typename T, typename Allocator, bool CacheHash>
+List<T, Allocator, CacheHash>::~List() noexcept {
   clear();
 }
 
-template<typename T, typename Allocator>
-void List<T, Allocator>::move_alloc(List<T, Allocator>& other_list) noexcept {
+template<typename T, typename Allocator, bool CacheHash>
+void List<T, Allocator, CacheHash>::move_alloc(List<T, Allocator, CacheHash>& other_list) noexcept {
   node_allocator_ = std::move(NodeTraits::propagate_on_container_copy_assignment::value ?
                               other_list.node_allocator_ : node_allocator_);
   base_node_allocator_ = std::move(BaseNodeTraits::propagate_on_container_copy_assignment::value ?
                                    other_list.base_node_allocator_ : base_node_allocator_);
 }
 
-template<typename T, typename Allocator>
-void List<T, Allocator>::move_data(List<T, Allocator>& other_list) noexcept {
+template<typename T, typename Allocator, bool CacheHash>
+void List<T, Allocator, CacheHash>::move_data(List<T, Allocator, CacheHash>& other_list) noexcept {
   ptr_on_fake_node_ = std::move(other_list.ptr_on_fake_node_);
   size_ = other_list.size_;
 }
 
-template<typename T, typename Allocator>
-void List<T, Allocator>::swap_alloc(List<T, Allocator>& other_list) noexcept {
+template<typename T, typename Allocator, bool CacheHash>
+void List<T, Allocator, CacheHash>::swap_alloc(List<T, Allocator, CacheHash>& other_list) noexcept {
   std::swap(base_node_allocator_, other_list.base_node_allocator_);
   std::swap(node_allocator_, other_list.node_allocator_);
 }
 
-template<typename T, typename Allocator>
-void List<T, Allocator>::swap_data(List<T, Allocator>& other_list) noexcept {
+template<typename T, typename Allocator, bool CacheHash>
+void List<T, Allocator, CacheHash>::swap_data(List<T, Allocator, CacheHash>& other_list) noexcept {
   std::swap(ptr_on_fake_node_, other_list.ptr_on_fake_node_);
   std::swap(size_, other_list.size_);
 }
 
-template<typename T, typename Allocator>
-List<T, Allocator>& List<T, Allocator>::operator=(const List& other_list) {
-  List<T, Allocator> tmp_list(
+template<typename T, typename Allocator, bool CacheHash>
+List<T, Allocator, CacheHash>& List<T, Allocator, CacheHash>::operator=(const List& other_list) {
+  List<T, Allocator, CacheHash> tmp_list(
       NodeTraits::propagate_on_container_copy_assignment::value ? other_list.node_allocator_ : node_allocator_);
   tmp_list.add_elements(other_list);
   swap_alloc(tmp_list);
@@ -227,8 +355,8 @@ List<T, Allocator>& List<T, Allocator>::operator=(const List& other_list) {
   return *this;
 }
 
-template<typename T, typename Allocator>
-List<T, Allocator>& List<T, Allocator>::operator=(List&& other_list) noexcept {
+template<typename T, typename Allocator, bool CacheHash>
+List<T, Allocator, CacheHash>& List<T, Allocator, CacheHash>::operator=(List&& other_list) noexcept {
   if (this != &other_list) {
     move_alloc(other_list);
     swap_data(other_list);
@@ -236,19 +364,19 @@ List<T, Allocator>& List<T, Allocator>::operator=(List&& other_list) noexcept {
   return *this;
 }
 
-template<typename T, typename Allocator>
-Allocator List<T, Allocator>::get_allocator() const {
+template<typename T, typename Allocator, bool CacheHash>
+Allocator List<T, Allocator, CacheHash>::get_allocator() const {
   return Allocator(node_allocator_);
 }
 
-template<typename T, typename Allocator>
-size_t List<T, Allocator>::size() const noexcept {
+template<typename T, typename Allocator, bool CacheHash>
+size_t List<T, Allocator, CacheHash>::size() const noexcept {
   return size_;
 }
 
-template<typename T, typename Allocator>
+template<typename T, typename Allocator, bool CacheHash>
 template<typename... Args>
-typename List<T, Allocator>::iterator List<T, Allocator>::emplace(List::const_iterator iter, Args&& ... args) {
+typename List<T, Allocator, CacheHash>::iterator List<T, Allocator, CacheHash>::emplace(List::const_iterator iter, Args&& ... args) {
   auto alloc = Allocator(node_allocator_);
   T* ptr_on_value = AllocTraits::allocate(alloc, 1);
   try {
@@ -276,8 +404,8 @@ typename List<T, Allocator>::iterator List<T, Allocator>::emplace(List::const_it
   return iterator(cur);
 }
 
-template<typename T, typename Allocator>
-typename List<T, Allocator>::iterator List<T, Allocator>::emplace(
+template<typename T, typename Allocator, bool CacheHash>
+typename List<T, Allocator, CacheHash>::iterator List<T, Allocator, CacheHash>::emplace(
     List::const_iterator iter, T* ptr_on_value) {
   Node* ptr = NodeTraits::allocate(node_allocator_, 1);
   try {
@@ -296,113 +424,101 @@ typename List<T, Allocator>::iterator List<T, Allocator>::emplace(
   return iterator(cur);
 }
 
-template<typename T, typename Allocator>
-void List<T, Allocator>::push_back(const T& value) {
+template<typename T, typename Allocator, bool CacheHash>
+void List<T, Allocator, CacheHash>::push_back(const T& value) {
   emplace(end(), value);
 }
 
-template<typename T, typename Allocator>
-void List<T, Allocator>::push_back(T&& value) {
+template<typename T, typename Allocator, bool CacheHash>
+void List<T, Allocator, CacheHash>::push_back(T&& value) {
   emplace(end(), std::move(value));
 }
 
-template<typename T, typename Allocator>
-void List<T, Allocator>::push_back(T* ptr_on_value) {
+template<typename T, typename Allocator, bool CacheHash>
+void List<T, Allocator, CacheHash>::push_back(T* ptr_on_value) {
   emplace(end(), ptr_on_value);
 }
 
-template<typename T, typename Allocator>
-void List<T, Allocator>::push_front(const T& value) {
+template<typename T, typename Allocator, bool CacheHash>
+void List<T, Allocator, CacheHash>::push_front(const T& value) {
   emplace(begin(), value);
 }
 
-template<typename T, typename Allocator>
-void List<T, Allocator>::push_front(T&& value) {
+template<typename T, typename Allocator, bool CacheHash>
+void List<T, Allocator, CacheHash>::push_front(T&& value) {
   emplace(begin(), std::move(value));
 }
 
-template<typename T, typename Allocator>
-void List<T, Allocator>::push_front(T* ptr_on_value) {
+template<typename T, typename Allocator, bool CacheHash>
+void List<T, Allocator, CacheHash>::push_front(T* ptr_on_value) {
   emplace(begin(), ptr_on_value);
 }
 
-template<typename T, typename Allocator>
-void List<T, Allocator>::pop_back() noexcept {
+template<typename T, typename Allocator, bool CacheHash>
+void List<T, Allocator, CacheHash>::pop_back() noexcept {
   erase(std::prev(end()));
 }
 
-template<typename T, typename Allocator>
-void List<T, Allocator>::pop_front() noexcept {
+template<typename T, typename Allocator, bool CacheHash>
+void List<T, Allocator, CacheHash>::pop_front() noexcept {
   erase(begin());
 }
 
-template<typename T, typename Allocator>
+template<typename T, typename Allocator, bool CacheHash>
 template<typename... Args>
-typename List<T, Allocator>::iterator List<T, Allocator>::insert(
+typename List<T, Allocator, CacheHash>::iterator List<T, Allocator, CacheHash>::insert(
     List::const_iterator iter, const T& value) {
   return emplace(iter, value);
 }
 
-template<typename T, typename Allocator>
+template<typename T, typename Allocator, bool CacheHash>
 template<typename... Args>
-typename List<T, Allocator>::iterator List<T, Allocator>::insert(
+typename List<T, Allocator, CacheHash>::iterator List<T, Allocator, CacheHash>::insert(
     List::const_iterator iter, T&& value) {
   return emplace(iter, std::move(value));
 }
 
-template<typename T, typename Allocator>
-typename List<T, Allocator>::iterator List<T, Allocator>::erase(
+template<typename T, typename Allocator, bool CacheHash>
+typename List<T, Allocator, CacheHash>::iterator List<T, Allocator, CacheHash>::erase(
     List::const_iterator iter) noexcept {
-  BaseNode* node_to_delete = iter.get_node();
-  BaseNode* prev = node_to_delete->prev;
-  BaseNode* next = node_to_delete->next;
-  prev->next = next;
-  next->prev = prev;
-
-  auto alloc = Allocator(node_allocator_);
-  AllocTraits::destroy(alloc, iterator(iter.get_node()).operator->());
-  AllocTraits::deallocate(alloc, iterator(iter.get_node()).operator->(), 1);
-
-  NodeTraits::destroy(node_allocator_, reinterpret_cast<Node*>(node_to_delete));
-  NodeTraits::deallocate(node_allocator_, reinterpret_cast<Node*>(node_to_delete), 1);
-
-  --size_;
+  BaseNode* next = iter.get_node()->next;
+  free_node(unlink(iter), Allocator(node_allocator_));
   return iterator(next);
 }
 
-template<typename T, typename Allocator>
-typename List<T, Allocator>::iterator List<T, Allocator>::begin() noexcept {
+template<typename T, typename Allocator, bool CacheHash>
+typename List<T, Allocator, CacheHash>::iterator List<T, Allocator, CacheHash>::begin() noexcept {
   return iterator(ptr_on_fake_node_->next);
 }
 
-template<typename T, typename Allocator>
-typename List<T, Allocator>::const_iterator List<T, Allocator>::begin() const noexcept {
+template<typename T, typename Allocator, bool CacheHash>
+typename List<T, Allocator, CacheHash>::const_iterator List<T, Allocator, CacheHash>::begin() const noexcept {
   return const_iterator(ptr_on_fake_node_->next);
 }
 
-template<typename T, typename Allocator>
-typename List<T, Allocator>::const_iterator List<T, Allocator>::cbegin() const noexcept {
+template<typename T, typename Allocator, bool CacheHash>
+typename List<T, Allocator, CacheHash>::const_iterator List<T, Allocator, CacheHash>::cbegin() const noexcept {
   return const_iterator(ptr_on_fake_node_->next);
 }
 
-template<typename T, typename Allocator>
-typename List<T, Allocator>::iterator List<T, Allocator>::end() noexcept {
+template<typename T, typename Allocator, bool CacheHash>
+typename List<T, Allocator, CacheHash>::iterator List<T, Allocator, CacheHash>::end() noexcept {
   return iterator(ptr_on_fake_node_);
 }
 
-template<typename T, typename Allocator>
-typename List<T, Allocator>::const_iterator List<T, Allocator>::end() const noexcept {
+template<typename T, typename Allocator, bool CacheHash>
+typename List<T, Allocator, CacheHash>::const_iterator List<T, Allocator, CacheHash>::end() const noexcept {
   return const_iterator(ptr_on_fake_node_);
 }
 
-template<typename T, typename Allocator>
-typename List<T, Allocator>::const_iterator List<T, Allocator>::cend() const noexcept {
+template<typename T, typename Allocator, bool CacheHash>
+typename List<T, Allocator, CacheHash>::const_iterator List<T, Allocator, CacheHash>::cend() const noexcept {
   return const_iterator(ptr_on_fake_node_);
 }
 
-template<typename T, typename Allocator>
+template<typename T, typename Allocator, bool CacheHash>
 template<bool is_const>
-class List<T, Allocator>::CommonIterator {
+class List<T, Allocator, CacheHash>::CommonIterator {
  private:
   BaseNode* node_;
 
@@ -435,154 +551,369 @@ class List<T, Allocator>::CommonIterator {
   BaseNode* get_node() const noexcept;
 };
 
-template<typename T, typename Allocator>
+template<typename T, typename Allocator, bool CacheHash>
 template<bool is_const>
-List<T, Allocator>::CommonIterator<is_const>::CommonIterator() noexcept = default;
+List<T, Allocator, CacheHash>::CommonIterator<is_const>::CommonIterator() noexcept = default;
 
-template<typename T, typename Allocator>
+template<typename T, typename Allocator, bool CacheHash>
 template<bool is_const>
-List<T, Allocator>::CommonIterator<is_const>::CommonIterator(BaseNode* node) noexcept
+List<T, Allocator, CacheHash>::CommonIterator<is_const>::CommonIterator(BaseNode* node) noexcept
     : node_(node) {}
 
-template<typename T, typename Allocator>
+template<typename T, typename Allocator, bool CacheHash>
 template<bool is_const>
-List<T, Allocator>::CommonIterator<is_const>::operator CommonIterator<true>() const noexcept {
+List<T, Allocator, CacheHash>::CommonIterator<is_const>::operator CommonIterator<true>() const noexcept {
   return CommonIterator<true>(node_);
 }
 
-template<typename T, typename Allocator>
+template<typename T, typename Allocator, bool CacheHash>
 template<bool is_const>
-typename List<T, Allocator>::template CommonIterator<is_const>&
-List<T, Allocator>::CommonIterator<is_const>::operator--() noexcept {
+typename List<T, Allocator, CacheHash>::template CommonIterator<is_const>&
+List<T, Allocator, CacheHash>::CommonIterator<is_const>::operator--() noexcept {
   node_ = node_->prev;
   return *this;
 }
 
-template<typename T, typename Allocator>
+template<typename T, typename Allocator, bool CacheHash>
 template<bool is_const>
-typename List<T, Allocator>::template CommonIterator<is_const>&
-List<T, Allocator>::CommonIterator<is_const>::operator++() noexcept {
+typename List<T, Allocator, CacheHash>::template CommonIterator<is_const>&
+List<T, Allocator, CacheHash>::CommonIterator<is_const>::operator++() noexcept {
   node_ = node_->next;
   return *this;
 }
 
-template<typename T, typename Allocator>
+template<typename T, typename Allocator, bool CacheHash>
 template<bool is_const>
-typename List<T, Allocator>::template CommonIterator<is_const>
-List<T, Allocator>::CommonIterator<is_const>::operator--(int) noexcept {
+typename List<T, Allocator, CacheHash>::template CommonIterator<is_const>
+List<T, Allocator, CacheHash>::CommonIterator<is_const>::operator--(int) noexcept {
   CommonIterator<is_const> tmp(*this);
   --(*this);
   return tmp;
 }
 
-template<typename T, typename Allocator>
+template<typename T, typename Allocator, bool CacheHash>
 template<bool is_const>
-typename List<T, Allocator>::template CommonIterator<is_const>
-List<T, Allocator>::CommonIterator<is_const>::operator++(int) noexcept {
+typename List<T, Allocator, CacheHash>::template CommonIterator<is_const>
+List<T, Allocator, CacheHash>::CommonIterator<is_const>::operator++(int) noexcept {
   CommonIterator<is_const> tmp(*this);
   ++(*this);
   return tmp;
 }
 
 
-template<typename T, typename Allocator>
+template<typename T, typename Allocator, bool CacheHash>
 template<bool is_const>
-typename List<T, Allocator>::template CommonIterator<is_const>&
-List<T, Allocator>::CommonIterator<is_const>::operator+=(ssize_t val) noexcept {
+typename List<T, Allocator, CacheHash>::template CommonIterator<is_const>&
+List<T, Allocator, CacheHash>::CommonIterator<is_const>::operator+=(ssize_t val) noexcept {
   while (val-- > 0) {
     ++(*this);
   }
   return *this;
 }
 
-template<typename T, typename Allocator>
+template<typename T, typename Allocator, bool CacheHash>
 template<bool is_const>
-typename List<T, Allocator>::template CommonIterator<is_const>
-List<T, Allocator>::CommonIterator<is_const>::operator+(ssize_t val) const noexcept {
+typename List<T, Allocator, CacheHash>::template CommonIterator<is_const>
+List<T, Allocator, CacheHash>::CommonIterator<is_const>::operator+(ssize_t val) const noexcept {
   CommonIterator temp_iterator(*this);
   temp_iterator += val;
   return temp_iterator;
 }
 
-template<typename T, typename Allocator>
+template<typename T, typename Allocator, bool CacheHash>
 template<bool is_const>
-typename List<T, Allocator>::template CommonIterator<is_const>::reference
-List<T, Allocator>::CommonIterator<is_const>::operator*() const noexcept {
+typename List<T, Allocator, CacheHash>::template CommonIterator<is_const>::reference
+List<T, Allocator, CacheHash>::CommonIterator<is_const>::operator*() const noexcept {
   return *reinterpret_cast<Node*>(node_)->ptr_on_value;
 }
 
-template<typename T, typename Allocator>
+template<typename T, typename Allocator, bool CacheHash>
 template<bool is_const>
-typename List<T, Allocator>::template CommonIterator<is_const>::pointer
-List<T, Allocator>::CommonIterator<is_const>::operator->() const noexcept {
+typename List<T, Allocator, CacheHash>::template CommonIterator<is_const>::pointer
+List<T, Allocator, CacheHash>::CommonIterator<is_const>::operator->() const noexcept {
   return reinterpret_cast<Node*>(node_)->ptr_on_value;
 };
 
-template<typename T, typename Allocator>
+template<typename T, typename Allocator, bool CacheHash>
 template<bool is_const>
-bool List<T, Allocator>::CommonIterator<is_const>::operator==(
-    const List<T, Allocator>::CommonIterator<is_const>& other_iter) const noexcept {
+bool List<T, Allocator, CacheHash>::CommonIterator<is_const>::operator==(
+    const List<T, Allocator, CacheHash>::CommonIterator<is_const>& other_iter) const noexcept {
   return (node_ == other_iter.node_);
 }
 
-template<typename T, typename Allocator>
+template<typename T, typename Allocator, bool CacheHash>
 template<bool is_const>
-bool List<T, Allocator>::CommonIterator<is_const>::operator!=(
-    const List<T, Allocator>::CommonIterator<is_const>& other_iter) const noexcept {
+bool List<T, Allocator, CacheHash>::CommonIterator<is_const>::operator!=(
+    const List<T, Allocator, CacheHash>::CommonIterator<is_const>& other_iter) const noexcept {
   return !(*this == other_iter);
 }
 
-template<typename T, typename Allocator>
+template<typename T, typename Allocator, bool CacheHash>
 template<bool is_const>
-typename List<T, Allocator>::BaseNode*
-List<T, Allocator>::CommonIterator<is_const>::get_node() const noexcept {
+typename List<T, Allocator, CacheHash>::BaseNode*
+List<T, Allocator, CacheHash>::CommonIterator<is_const>::get_node() const noexcept {
   return reinterpret_cast<BaseNode*>(node_);
 }
 
+constexpr size_t mix_hash(size_t hash) noexcept {
+  uint64_t x = hash;
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ULL;
+  x ^= x >> 33;
+  return static_cast<size_t>(x);
+}
+
+// Splits mixed hashes over partitions by their high half, which leaves the
+// low half to pick a slot or bucket inside the partition.
+constexpr size_t partition_of(size_t hash, size_t partitions) noexcept {
+  return static_cast<size_t>((static_cast<uint64_t>(hash) >> 32) * partitions >> 32);
+}
+
+// Calls function(i) for every i < threads, on the calling thread and
+// threads - 1 new ones, and rethrows the first exception afterwards.
+template<typename Function>
+void run_parallel(size_t threads, Function&& function) {
+  std::vector<std::exception_ptr> errors(threads);
+  auto body = [&function, &errors](size_t index) {
+    try {
+      function(index);
+    } catch (...) {
+      errors[index] = std::current_exception();
+    }
+  };
+  std::vector<std::thread> workers;
+  workers.reserve(threads);
+  for (size_t i = 1; i < threads; ++i) {
+    try {
+      workers.emplace_back(body, i);
+    } catch (...) {
+      body(i);
+    }
+  }
+  body(0);
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  for (auto& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+}
+
+// Bucket index policies: bucket_count() rounds a requested table size to one
+// the policy supports, operator() maps a hash to [0, bucket_count).
+struct ModuloBucketPolicy {
+  size_t bucket_count(size_t count) const noexcept {
+    return count;
+  }
+
+  size_t operator()(size_t hash, size_t bucket_count) const noexcept {
+    return hash % bucket_count;
+  }
+};
+
+// std::hash of integers is the identity, so the low bits are mixed before masking.
+struct PowerOfTwoBucketPolicy {
+  size_t bucket_count(size_t count) const noexcept {
+    size_t result = 1;
+    while (result < count) {
+      result <<= 1;
+    }
+    return result;
+  }
+
+  size_t operator()(size_t hash, size_t bucket_count) const noexcept {
+    return mix_hash(hash) & (bucket_count - 1);
+  }
+};
+
+// Lemire's multiply-shift range reduction, works for any table size.
+struct FastRangeBucketPolicy {
+  size_t bucket_count(size_t count) const noexcept {
+    return count;
+  }
+
+  size_t operator()(size_t hash, size_t bucket_count) const noexcept {
+    return static_cast<size_t>((static_cast<unsigned __int128>(mix_hash(hash)) * bucket_count) >> 64);
+  }
+};
+
+// Picks the shard of a key's hash for the sharded containers. The hash is
+// mixed once more than any bucket policy mixes it, so the shard says nothing
+// about the bucket inside the shard.
+inline size_t shard_of(size_t hash, size_t shard_count) noexcept {
+  return FastRangeBucketPolicy()(mix_hash(hash), shard_count);
+}
+
 template<typename Key, typename Value, typename Hash = std::hash<Key>,
     typename Equal = std::equal_to<Key>,
-    typename Alloc = std::allocator<std::pair<const Key, Value>>>
+    typename Alloc = std::allocator<std::pair<const Key, Value>>,
+    typename BucketPolicy = ModuloBucketPolicy>
 class UnorderedMap {
  public:
   using AllocTraits = std::allocator_traits<Alloc>;
   using node_type = std::pair<const Key, Value>;
-  using iterator = typename List<node_type, Alloc>::iterator;
-  using const_iterator = typename List<node_type, Alloc>::const_iterator;
+  // As in libstdc++, nodes keep the hash of their key unless the key is a
+  // number, an enum or a pointer, whose hashes are cheap to compute again.
+  // Stored hashes are only set while the map has a table.
+  static constexpr bool CACHE_HASH_ =
+      !std::is_arithmetic_v<Key> && !std::is_enum_v<Key> && !std::is_pointer_v<Key>;
+  using iterator = typename List<node_type, Alloc, CACHE_HASH_>::iterator;
+  using const_iterator = typename List<node_type, Alloc, CACHE_HASH_>::const_iterator;
+
+  // Owns a node extracted from a map; inserting it into a map with an equal
+  // allocator relinks the node without touching the value.
+  class node_handle {
+   private:
+    friend class UnorderedMap;
+
+    iterator node_ = iterator(nullptr);
+    std::optional<Alloc> allocator_;
+
+    node_handle(iterator, const Alloc&) noexcept;
+
+   public:
+    node_handle() noexcept = default;
+    node_handle(const node_handle&) = delete;
+    node_handle& operator=(const node_handle&) = delete;
+    node_handle(node_handle&&) noexcept;
+    node_handle& operator=(node_handle&&) noexcept;
+    ~node_handle() noexcept;
+
+    bool empty() const noexcept;
+    explicit operator bool() const noexcept;
+    const Key& key() const noexcept;
+    Value& mapped() const noexcept;
+    Alloc get_allocator() const;
+  };
+
+  struct insert_return_type {
+    iterator position;
+    bool inserted;
+    node_handle node;
+  };
+
+  struct Stats {
+    size_t size = 0;
+    size_t bucket_count = 0;
+    size_t empty_buckets = 0;
+    float empty_bucket_ratio = 0;
+    size_t max_chain_length = 0;
+    // Over non-empty buckets.
+    float mean_chain_length = 0;
+    // occupancy[k] is the number of buckets holding k nodes.
+    std::vector<size_t> occupancy;
+    size_t rehash_count = 0;
+    std::chrono::steady_clock::duration rehash_time{};
+    size_t bloom_filter_bytes = 0;
+  };
 
  private:
   static const size_t DEFAULT_TABLE_SIZE_ = 64;
+  // Up to SMALL_SIZE_ elements the map has no buckets at all: lookups scan
+  // list_ and the first table is allocated when the next element arrives.
+  static const size_t SMALL_SIZE_ = 8;
+  // Batched lookups run three prefetch stages (bucket, node, value) that are
+  // PREFETCH_DISTANCE_ keys apart; the window must hold all keys in flight.
+  static const size_t PREFETCH_DISTANCE_ = 8;
+  static const size_t PREFETCH_WINDOW_ = 32;
   float max_load_factor_ = 0.66;
+  float min_load_factor_ = 0;
 
   Alloc allocator_ = Alloc();
-  using bucket_bounds = std::pair<iterator, iterator>;
-  using hash_table_type = std::vector<bucket_bounds,
-      typename AllocTraits::template rebind_alloc<bucket_bounds>>;
-  List<node_type, Alloc> list_ = List<node_type, Alloc>(allocator_);
-  hash_table_type hash_table_ = hash_table_type(
-      DEFAULT_TABLE_SIZE_, {end(), end()}, allocator_);
+  // A bucket holds its first node, or end() when empty. Nodes of a bucket are
+  // contiguous in list_, so the bucket ends at the first node hashing elsewhere.
+  using bucket_type = iterator;
+  using hash_table_type = std::vector<bucket_type,
+      typename AllocTraits::template rebind_alloc<bucket_type>>;
+  List<node_type, Alloc, CACHE_HASH_> list_ = List<node_type, Alloc, CACHE_HASH_>(allocator_);
+  BucketPolicy bucket_policy_ = BucketPolicy();
+  hash_table_type hash_table_ = hash_table_type(allocator_);
   Equal key_equal_ = Equal();
   Hash hasher_ = Hash();
 
+  // While an incremental rehash is in progress the previous table stays alive:
+  // its buckets below migrated_buckets_ have already been moved to hash_table_.
+  hash_table_type old_hash_table_ = hash_table_type(allocator_);
+  size_t migrated_buckets_ = 0;
+  size_t rehash_step_ = 0;
+
+  size_t rehash_count_ = 0;
+  std::chrono::steady_clock::duration rehash_time_{};
+
+  // Optional blocked Bloom filter in front of the buckets: a key sets one bit
+  // in each word of a single cache line, so most misses cost one probe. It is
+  // sized for the load the table grows at and rebuilt with every new table;
+  // erased keys leave their bits until then. Small maps go without it.
+  // An incremental rehash fills the new filter as buckets migrate, and
+  // lookups check the previous one, old_bloom_, until the migration ends.
+  struct alignas(64) BloomBlock {
+    uint64_t words[8];
+  };
+  using bloom_type = std::vector<BloomBlock,
+      typename AllocTraits::template rebind_alloc<BloomBlock>>;
+  static const size_t BLOOM_BLOCK_BITS_ = 512;
+  bloom_type bloom_ = bloom_type(allocator_);
+  bloom_type old_bloom_ = bloom_type(allocator_);
+  size_t bloom_bits_per_key_ = 0;
+
   void delete_elements() noexcept;
 
   void swap_alloc(UnorderedMap&) noexcept;
-  void swap_data(UnorderedMap&) noexcept;
 
   void move_data(UnorderedMap&) noexcept;
 
+  bool is_small() const noexcept;
   size_t get_hash(const Key&) const noexcept;
-  void rehash(size_t);
-  void add_elements(const UnorderedMap&);
-
-  iterator find(const Key&, size_t) noexcept;
-  iterator find(Key&&, size_t) noexcept;
+  bucket_type& get_bucket(const Key&) noexcept;
+  bucket_type& get_bucket_by_hash(size_t) noexcept;
+  // The hash of a node's key: the stored one, or hashed again if not cached.
+  size_t node_hash(const_iterator) const noexcept;
+  static void cache_hash(iterator, size_t) noexcept;
+  bool in_bucket(const_iterator, const bucket_type&) noexcept;
+  size_t chain_length(const bucket_type&) noexcept;
+  void link(bucket_type&, iterator) noexcept;
+  void grow();
+  void shrink();
+  // Makes room for one more element: leaves small mode, shrinks or grows.
+  void prepare_insert();
+  void detach(bucket_type&, const iterator&) noexcept;
+  void detach(const iterator&) noexcept;
+  iterator attach(iterator) noexcept;
+  void migrate(size_t) noexcept;
+  // rehash_step_, raised so that a migration always ends before the next
+  // growth: that comes after about max_load_factor_ inserts per old bucket.
+  size_t migration_step() const noexcept;
+  // Copies the nodes of another map in list order, then sets the bucket
+  // heads: the first node of each run is its head.
+  void clone_elements(const UnorderedMap&);
+
+  // An empty filter for a table of the given size, or none if disabled.
+  bloom_type make_bloom(size_t) const;
+  void bloom_add(size_t) noexcept;
+  static bool bloom_test(const bloom_type&, uint64_t) noexcept;
+  bool bloom_may_contain(size_t) const noexcept;
+  // Clears the filter and adds every key again; the previous one is dropped.
+  void bloom_refill() noexcept;
+
+  iterator find_small(const Key&) noexcept;
+  iterator find(const Key&, bucket_type&) noexcept;
+  iterator find(Key&&, bucket_type&) noexcept;
+  template<typename InputIterator, typename Function>
+  void find_each(InputIterator, InputIterator, Function&&);
 
  public:
   UnorderedMap();
   UnorderedMap(size_t, const Alloc&);
   UnorderedMap(size_t, const Hash& hasher,
                const Equal& key_equal, const Alloc& alloc);
+  // Copies keep the settings and the table layout of the source, including
+  // an incremental rehash in progress, and hash each key once.
   UnorderedMap(const UnorderedMap&);
+  UnorderedMap(const UnorderedMap&, const Alloc&);
   UnorderedMap& operator=(const UnorderedMap&);
   UnorderedMap(UnorderedMap&&) noexcept;
   UnorderedMap& operator=(UnorderedMap&&) noexcept;
@@ -594,6 +925,15 @@ class UnorderedMap {
   const_iterator find(const Key&) const noexcept;
   iterator find(Key&&) noexcept;
   const_iterator find(Key&&) const noexcept;
+  bool contains(const Key&) const noexcept;
+  size_t count(const Key&) const noexcept;
+
+  // Look up a range of keys, writing an iterator (or a bool) per key to out;
+  // cache misses of neighbouring keys are overlapped.
+  template<typename InputIterator, typename OutputIterator>
+  void find_batch(InputIterator, InputIterator, OutputIterator);
+  template<typename InputIterator, typename OutputIterator>
+  void contains_batch(InputIterator, InputIterator, OutputIterator) const;
 
   template<typename... Args>
   std::pair<iterator, bool> emplace(Args&& ...);
@@ -602,6 +942,10 @@ class UnorderedMap {
   std::pair<iterator, bool> insert(node_type&&);
   template<typename InputIterator>
   void insert(const InputIterator&, const InputIterator&);
+  // Hashes the input in parallel, partitions it by bucket range and lets each
+  // thread rebuild the chain of its own buckets; Alloc must be thread-safe.
+  template<typename RandomAccessIterator>
+  void parallel_insert(RandomAccessIterator, RandomAccessIterator, size_t);
 
   template<typename P>
   std::pair<iterator, bool> insert(P&& value) {
@@ -609,9 +953,18 @@ class UnorderedMap {
   }
 
   void erase(const iterator&) noexcept;
+  // Hashes the key once and returns the number of erased elements.
+  size_t erase(const Key&) noexcept;
   template<typename InputIterator>
   void erase(InputIterator, InputIterator) noexcept;
 
+  node_handle extract(const iterator&) noexcept;
+  node_handle extract(const Key&) noexcept;
+  insert_return_type insert(node_handle&&);
+  // Moves every node whose key is not already here; the rest stay in source.
+  // Like insert(node_handle&&), throws std::invalid_argument if the allocators differ.
+  void merge(UnorderedMap&);
+
   Value& operator[](const Key&) noexcept;
   Value& at(const Key&);
   const Value& at(const Key&) const;
@@ -620,12 +973,49 @@ class UnorderedMap {
 
   void reserve(size_t);
   size_t max_size() const noexcept;
+  Hash hash_function() const;
+  Equal key_eq() const;
   float max_load_factor() const noexcept;
   void max_load_factor(float);
+  // Inserting below this load factor first halves the table until it is at
+  // most half full; 0 disables shrinking.
+  float min_load_factor() const noexcept;
+  void min_load_factor(float) noexcept;
+  // Rebuilds the table with at least the given number of buckets, but never
+  // fewer than size() / max_load_factor().
+  void rehash(size_t);
+  // Frees the table altogether if the map is small enough to go without one.
+  void shrink_to_fit();
+  // Buckets migrated per insert while growing; 0 rehashes all at once.
+  // Erasing never migrates, so it does not reorder a list being walked.
+  // Steps too small to finish before the next growth are raised.
+  size_t rehash_step() const noexcept;
+  void rehash_step(size_t) noexcept;
+  // Bits of the Bloom filter per key the table is sized for; 0 disables it.
+  // Around 10 bits reject ~99% of misses before any bucket is read.
+  size_t bloom_bits_per_key() const noexcept;
+  void bloom_bits_per_key(size_t);
   float load_factor() const noexcept;
   float load_factor(size_t) const noexcept;
   float load_factor(size_t, size_t) const noexcept;
 
+  // While an incremental rehash is in progress these describe the new table,
+  // whose buckets only hold the nodes migrated so far; stats() covers both.
+  // A small map has no buckets: bucket_count() is 0 and load_factor() is 0,
+  // while bucket() is 0 and bucket_size(0) is size(), as lookups scan all of
+  // it like one chain.
+  size_t bucket_count() const noexcept;
+  size_t bucket_size(size_t) const noexcept;
+  size_t bucket(const Key&) const noexcept;
+  // Walks every bucket, hashing each key once.
+  Stats stats() const;
+
+  // Splits the buckets into contiguous ranges, one per thread.
+  template<typename Function>
+  void parallel_for_each(Function&&, size_t);
+  template<typename Function>
+  void parallel_for_each(Function&&, size_t) const;
+
   iterator begin() noexcept;
   const_iterator begin() const noexcept;
   const_iterator cbegin() const noexcept;
@@ -634,91 +1024,142 @@ class UnorderedMap {
   const_iterator cend() const noexcept;
 };
 
-template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
-void UnorderedMap<Key, Value, Hash, Equal, Alloc>::delete_elements() noexcept {
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+void UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::delete_elements() noexcept {
   list_.delete_elements();
 }
 
-template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
-void UnorderedMap<Key, Value, Hash, Equal, Alloc>::swap_alloc(UnorderedMap& other_map) noexcept {
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+void UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::swap_alloc(UnorderedMap& other_map) noexcept {
   std::swap(allocator_, other_map.allocator_);
 }
 
-template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
-void UnorderedMap<Key, Value, Hash, Equal, Alloc>::swap_data(UnorderedMap& other_map) noexcept {
-  std::swap(hash_table_, other_map.hash_table_);
-  list_.swap_data(other_map.list_);
-  std::swap(hasher_, other_map.hasher_);
-  std::swap(key_equal_, other_map.key_equal_);
-  std::swap(max_load_factor_, other_map.max_load_factor_);
-}
-
-template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
-void UnorderedMap<Key, Value, Hash, Equal, Alloc>::move_data(UnorderedMap& other_map) noexcept {
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+void UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::move_data(UnorderedMap& other_map) noexcept {
   max_load_factor_ = other_map.max_load_factor_;
+  min_load_factor_ = other_map.min_load_factor_;
   list_ = std::move(other_map.list_);
   hash_table_ = std::move(other_map.hash_table_);
   key_equal_ = std::move(other_map.key_equal_);
   hasher_ = std::move(other_map.hasher_);
-}
-
-template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
-void UnorderedMap<Key, Value, Hash, Equal, Alloc>::add_elements(
+  bucket_policy_ = std::move(other_map.bucket_policy_);
+  old_hash_table_ = std::move(other_map.old_hash_table_);
+  migrated_buckets_ = other_map.migrated_buckets_;
+  rehash_step_ = other_map.rehash_step_;
+  rehash_count_ = other_map.rehash_count_;
+  rehash_time_ = other_map.rehash_time_;
+  bloom_ = std::move(other_map.bloom_);
+  old_bloom_ = std::move(other_map.old_bloom_);
+  bloom_bits_per_key_ = other_map.bloom_bits_per_key_;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+void UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::clone_elements(
     const UnorderedMap& other_map) {
-  for (auto it = other_map.begin(); it != other_map.end(); ++it) {
-    try {
-      insert(*it);
-    } catch (...) {
-      while (size() > 0) {
-        erase(begin());
+  iterator first = end();
+  iterator last = end();
+  size_t count = 0;
+  try {
+    for (auto it = other_map.begin(); it != other_map.end(); ++it) {
+      node_type* ptr = AllocTraits::allocate(allocator_, 1);
+      iterator node = end();
+      try {
+        AllocTraits::construct(allocator_, ptr, *it);
+        try {
+          node = list_.make_node(ptr);
+        } catch (...) {
+          AllocTraits::destroy(allocator_, ptr);
+          throw;
+        }
+        cache_hash(node, other_map.node_hash(it));
+      } catch (...) {
+        AllocTraits::deallocate(allocator_, ptr, 1);
+        throw;
       }
-      throw;
+      if (count == 0) {
+        first = node;
+      } else {
+        List<node_type, Alloc, CACHE_HASH_>::chain(last, node);
+      }
+      last = node;
+      ++count;
+    }
+  } catch (...) {
+    list_.assign_chain(first, last, count);
+    throw;
+  }
+  list_.assign_chain(first, last, count);
+  if (is_small()) {
+    return;
+  }
+  for (auto it = begin(); it != end(); ++it) {
+    auto& bucket = get_bucket_by_hash(node_hash(it));
+    if (bucket == end()) {
+      bucket = it;
     }
   }
 }
 
-template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
-UnorderedMap<Key, Value, Hash, Equal, Alloc>::UnorderedMap() = default;
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::UnorderedMap() = default;
 
-template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
-UnorderedMap<Key, Value, Hash, Equal, Alloc>::UnorderedMap(
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::UnorderedMap(
     size_t bucket_count, const Alloc& alloc) :
     UnorderedMap(bucket_count, Hash(), Equal(), alloc) {}
 
-template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
-UnorderedMap<Key, Value, Hash, Equal, Alloc>::UnorderedMap(
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::UnorderedMap(
     size_t bucket_count, const Hash& hasher,
-    const Equal& key_equal, const Alloc& alloc) : allocator_(alloc), hash_table_(bucket_count, {end(), end()}, alloc),
+    const Equal& key_equal, const Alloc& alloc) : allocator_(alloc),
+                                                  hash_table_(bucket_policy_.bucket_count(bucket_count),
+                                                              end(), alloc),
                                                   key_equal_(key_equal), hasher_(hasher) {}
 
-template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
-UnorderedMap<Key, Value, Hash, Equal, Alloc>::UnorderedMap(const UnorderedMap& other_map) :
-    UnorderedMap(DEFAULT_TABLE_SIZE_, AllocTraits::select_on_container_copy_construction(other_map.allocator_)) {
-  insert(other_map.begin(), other_map.end());
-}
-
-template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
-UnorderedMap<Key, Value, Hash, Equal, Alloc>&
-UnorderedMap<Key, Value, Hash, Equal, Alloc>::operator=(const UnorderedMap& other_map) {
-  UnorderedMap<Key, Value, Hash, Equal, Alloc> tmp_map(
-      AllocTraits::propagate_on_container_copy_assignment::value ?
-      other_map.allocator_ : allocator_);
-  tmp_map.add_elements(other_map);
-  swap_alloc(tmp_map);
-  swap_data(tmp_map);
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::UnorderedMap(const UnorderedMap& other_map) :
+    UnorderedMap(other_map, AllocTraits::select_on_container_copy_construction(other_map.allocator_)) {}
+
+// The Bloom filter is copied bit for bit, stale bits of erased keys included.
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::UnorderedMap(const UnorderedMap& other_map, const Alloc& alloc) :
+    max_load_factor_(other_map.max_load_factor_), min_load_factor_(other_map.min_load_factor_),
+    allocator_(alloc), bucket_policy_(other_map.bucket_policy_),
+    hash_table_(other_map.hash_table_.size(), end(), alloc),
+    key_equal_(other_map.key_equal_), hasher_(other_map.hasher_),
+    old_hash_table_(other_map.old_hash_table_.size(), end(), alloc),
+    migrated_buckets_(other_map.migrated_buckets_), rehash_step_(other_map.rehash_step_),
+    bloom_(other_map.bloom_, alloc), old_bloom_(other_map.old_bloom_, alloc),
+    bloom_bits_per_key_(other_map.bloom_bits_per_key_) {
+  clone_elements(other_map);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>&
+UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::operator=(const UnorderedMap& other_map) {
+  if (this != &other_map) {
+    UnorderedMap tmp_map(other_map, AllocTraits::propagate_on_container_copy_assignment::value ?
+                                    other_map.allocator_ : allocator_);
+    *this = std::move(tmp_map);
+  }
   return *this;
 }
 
-template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
-UnorderedMap<Key, Value, Hash, Equal, Alloc>::UnorderedMap(UnorderedMap&& other_map) noexcept:
-    max_load_factor_(other_map.max_load_factor_),
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::UnorderedMap(UnorderedMap&& other_map) noexcept:
+    max_load_factor_(other_map.max_load_factor_), min_load_factor_(other_map.min_load_factor_),
     allocator_(std::move(AllocTraits::select_on_container_copy_construction(other_map.allocator_))),
-    list_(std::move(other_map.list_)), hash_table_(std::move(other_map.hash_table_)),
-    key_equal_(std::move(other_map.key_equal_)), hasher_(std::move(other_map.hasher_)) {}
-
-template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
-UnorderedMap<Key, Value, Hash, Equal, Alloc>&
-UnorderedMap<Key, Value, Hash, Equal, Alloc>::operator=(UnorderedMap&& other_map) noexcept {
+    list_(std::move(other_map.list_)), bucket_policy_(std::move(other_map.bucket_policy_)),
+    hash_table_(std::move(other_map.hash_table_)),
+    key_equal_(std::move(other_map.key_equal_)), hasher_(std::move(other_map.hasher_)),
+    old_hash_table_(std::move(other_map.old_hash_table_)), migrated_buckets_(other_map.migrated_buckets_),
+    rehash_step_(other_map.rehash_step_), rehash_count_(other_map.rehash_count_),
+    rehash_time_(other_map.rehash_time_), bloom_(std::move(other_map.bloom_)),
+    old_bloom_(std::move(other_map.old_bloom_)), bloom_bits_per_key_(other_map.bloom_bits_per_key_) {}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>&
+UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::operator=(UnorderedMap&& other_map) noexcept {
   if (this != &other_map) {
     delete_elements();
     allocator_ = std::move(AllocTraits::propagate_on_container_copy_assignment::value ?
@@ -728,39 +1169,236 @@ UnorderedMap<Key, Value, Hash, Equal, Alloc>::operator=(UnorderedMap&& other_map
   return *this;
 }
 
-template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
-UnorderedMap<Key, Value, Hash, Equal, Alloc>::~UnorderedMap() noexcept = default;
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::~UnorderedMap() noexcept = default;
 
-template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
-size_t UnorderedMap<Key, Value, Hash, Equal, Alloc>::get_hash(const Key& key) const noexcept {
-  return hasher_(key) % hash_table_.size();
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+bool UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::is_small() const noexcept {
+  return hash_table_.empty();
 }
 
-template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
-void UnorderedMap<Key, Value, Hash, Equal, Alloc>::rehash(size_t bucket_count) {
-  auto new_list = List<node_type, Alloc>(allocator_);
-  hash_table_ = hash_table_type(bucket_count, {new_list.end(), new_list.end()}, allocator_);
-  while (begin() != end()) {
-    auto it = begin();
-    const Key& key = it->first;
-    size_t hash = get_hash(key);
-    if (hash_table_[hash].first == hash_table_[hash].second) {
-      new_list.push_front(&(*it));
-      hash_table_[hash] = {new_list.begin(), new_list.begin() + 1};
-    } else {
-      new_list.emplace(hash_table_[hash].second, &(*it));
-      ++hash_table_[hash].second;
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+size_t UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::get_hash(const Key& key) const noexcept {
+  return bucket_policy_(hasher_(key), hash_table_.size());
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+typename UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::bucket_type&
+UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::get_bucket(const Key& key) noexcept {
+  return get_bucket_by_hash(hasher_(key));
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+typename UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::bucket_type&
+UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::get_bucket_by_hash(size_t hash) noexcept {
+  if (!old_hash_table_.empty()) {
+    size_t old_index = bucket_policy_(hash, old_hash_table_.size());
+    if (old_index >= migrated_buckets_) {
+      return old_hash_table_[old_index];
+    }
+  }
+  return hash_table_[bucket_policy_(hash, hash_table_.size())];
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+size_t UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::node_hash(const_iterator it) const noexcept {
+  if constexpr (CACHE_HASH_) {
+    return List<node_type, Alloc, CACHE_HASH_>::hash_code(it);
+  } else {
+    return hasher_(it->first);
+  }
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+void UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::cache_hash(iterator it, size_t hash) noexcept {
+  if constexpr (CACHE_HASH_) {
+    List<node_type, Alloc, CACHE_HASH_>::hash_code(it, hash);
+  }
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+bool UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::in_bucket(
+    const_iterator it, const bucket_type& bucket) noexcept {
+  return it != end() && &get_bucket_by_hash(node_hash(it)) == &bucket;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+size_t UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::chain_length(const bucket_type& bucket) noexcept {
+  size_t result = 0;
+  for (auto it = bucket; it != end(); ++it) {
+    ++result;
+    if (!in_bucket(std::next(it), bucket)) {
+      break;
     }
-    list_.delete_node(it);
   }
-  list_ = std::move(new_list);
+  return result;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+void UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::link(bucket_type& bucket, iterator it) noexcept {
+  list_.splice(bucket == end() ? begin() : bucket, it);
+  bucket = it;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+void UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::migrate(size_t bucket_count) noexcept {
+  if (old_hash_table_.empty()) {
+    return;
+  }
+  auto start = std::chrono::steady_clock::now();
+  for (; bucket_count > 0 && migrated_buckets_ < old_hash_table_.size(); --bucket_count) {
+    size_t old_index = migrated_buckets_++;
+    for (auto it = old_hash_table_[old_index]; it != end();) {
+      size_t hash = node_hash(it);
+      if (bucket_policy_(hash, old_hash_table_.size()) != old_index) {
+        break;
+      }
+      auto next = std::next(it);
+      link(hash_table_[bucket_policy_(hash, hash_table_.size())], it);
+      bloom_add(hash);
+      it = next;
+    }
+  }
+  if (migrated_buckets_ == old_hash_table_.size()) {
+    hash_table_type(allocator_).swap(old_hash_table_);
+    bloom_type(allocator_).swap(old_bloom_);
+    migrated_buckets_ = 0;
+  }
+  rehash_time_ += std::chrono::steady_clock::now() - start;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+size_t UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::migration_step() const noexcept {
+  return std::max(rehash_step_, static_cast<size_t>(std::ceil(1 / max_load_factor_)) + 1);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+typename UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::bloom_type
+UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::make_bloom(size_t bucket_count) const {
+  if (bloom_bits_per_key_ == 0 || bucket_count == 0) {
+    return bloom_type(allocator_);
+  }
+  size_t keys = std::max(size_t(1), static_cast<size_t>(static_cast<float>(bucket_count) * max_load_factor_));
+  return bloom_type((keys * bloom_bits_per_key_ + BLOOM_BLOCK_BITS_ - 1) / BLOOM_BLOCK_BITS_,
+                    BloomBlock{}, allocator_);
+}
+
+// The block comes from the high bits of the mixed hash, the eight bit
+// positions from another multiply of it.
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+void UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::bloom_add(size_t hash) noexcept {
+  if (bloom_.empty()) {
+    return;
+  }
+  uint64_t mixed = mix_hash(hash);
+  auto& block = bloom_[static_cast<size_t>((static_cast<unsigned __int128>(mixed) * bloom_.size()) >> 64)];
+  uint64_t bits = mixed * 0x9e3779b97f4a7c15ULL;
+  for (size_t i = 0; i < 8; ++i) {
+    block.words[i] |= uint64_t(1) << ((bits >> (16 + 6 * i)) & 63);
+  }
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+bool UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::bloom_test(
+    const bloom_type& bloom, uint64_t mixed) noexcept {
+  const auto& block = bloom[static_cast<size_t>((static_cast<unsigned __int128>(mixed) * bloom.size()) >> 64)];
+  uint64_t bits = mixed * 0x9e3779b97f4a7c15ULL;
+  uint64_t found = 1;
+  for (size_t i = 0; i < 8; ++i) {
+    found &= block.words[i] >> ((bits >> (16 + 6 * i)) & 63);
+  }
+  return found != 0;
+}
+
+// Keys that have not migrated yet are only in the previous filter.
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+bool UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::bloom_may_contain(size_t hash) const noexcept {
+  uint64_t mixed = mix_hash(hash);
+  return bloom_test(bloom_, mixed) || (!old_bloom_.empty() && bloom_test(old_bloom_, mixed));
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+void UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::bloom_refill() noexcept {
+  bloom_type(allocator_).swap(old_bloom_);
+  if (bloom_.empty()) {
+    return;
+  }
+  std::fill(bloom_.begin(), bloom_.end(), BloomBlock{});
+  for (auto it = begin(); it != end(); ++it) {
+    bloom_add(node_hash(it));
+  }
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+void UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::grow() {
+  if (rehash_step_ == 0) {
+    rehash(2 * hash_table_.size());
+    return;
+  }
+  migrate(old_hash_table_.size());
+  hash_table_type new_table(bucket_policy_.bucket_count(2 * hash_table_.size()), end(), allocator_);
+  bloom_type new_bloom = make_bloom(new_table.size());
+  old_hash_table_.swap(hash_table_);
+  hash_table_.swap(new_table);
+  old_bloom_.swap(bloom_);
+  bloom_.swap(new_bloom);
+  ++rehash_count_;
+  migrate(migration_step());
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+void UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::shrink() {
+  size_t bucket_count = hash_table_.size();
+  while (bucket_count / 2 >= DEFAULT_TABLE_SIZE_ &&
+         load_factor(size() + 1, bucket_count / 2) <= max_load_factor_ / 2) {
+    bucket_count /= 2;
+  }
+  if (bucket_count != hash_table_.size()) {
+    rehash(bucket_count);
+  }
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+void UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::rehash(size_t bucket_count) {
+  bucket_count = std::max({bucket_count, static_cast<size_t>(std::ceil(size() / max_load_factor_)), size_t(1)});
+  migrate(old_hash_table_.size());
+  auto start = std::chrono::steady_clock::now();
+  bool cached = !is_small();
+  hash_table_type new_table(bucket_policy_.bucket_count(bucket_count), end(), allocator_);
+  bloom_type new_bloom = make_bloom(new_table.size());
+  hash_table_.swap(new_table);
+  bloom_.swap(new_bloom);
+  for (auto it = begin(); it != end();) {
+    auto next = std::next(it);
+    size_t hash = cached ? node_hash(it) : hasher_(it->first);
+    cache_hash(it, hash);
+    link(hash_table_[bucket_policy_(hash, hash_table_.size())], it);
+    bloom_add(hash);
+    it = next;
+  }
+  ++rehash_count_;
+  rehash_time_ += std::chrono::steady_clock::now() - start;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+typename UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::iterator
+UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::find(
+    const Key& key, bucket_type& bucket) noexcept {
+  for (auto it = bucket; it != end(); ++it) {
+    if (key_equal_(key, it->first)) {
+      return it;
+    }
+    if (!in_bucket(std::next(it), bucket)) {
+      break;
+    }
+  }
+  return end();
 }
 
-template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
-typename UnorderedMap<Key, Value, Hash, Equal, Alloc>::iterator
-UnorderedMap<Key, Value, Hash, Equal, Alloc>::find(
-    const Key& key, size_t key_hash) noexcept {
-  for (auto it = hash_table_[key_hash].first; it != hash_table_[key_hash].second && it != end(); ++it) {
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+typename UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::iterator
+UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::find_small(const Key& key) noexcept {
+  for (auto it = begin(); it != end(); ++it) {
     if (key_equal_(key, it->first)) {
       return it;
     }
@@ -768,44 +1406,139 @@ UnorderedMap<Key, Value, Hash, Equal, Alloc>::find(
   return end();
 }
 
-template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
-typename UnorderedMap<Key, Value, Hash, Equal, Alloc>::iterator
-UnorderedMap<Key, Value, Hash, Equal, Alloc>::find(const Key& key) noexcept {
-  return find(key, get_hash(key));
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+typename UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::iterator
+UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::find(const Key& key) noexcept {
+  if (is_small()) {
+    return find_small(key);
+  }
+  if (!bloom_.empty()) {
+    size_t hash = hasher_(key);
+    return bloom_may_contain(hash) ? find(key, get_bucket_by_hash(hash)) : end();
+  }
+  return find(key, get_bucket(key));
 }
 
-template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
-typename UnorderedMap<Key, Value, Hash, Equal, Alloc>::const_iterator
-UnorderedMap<Key, Value, Hash, Equal, Alloc>::find(const Key& key) const noexcept {
-  return static_cast<const_iterator>(find(key, get_hash(key)));
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+typename UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::const_iterator
+UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::find(const Key& key) const noexcept {
+  return static_cast<const_iterator>(const_cast<UnorderedMap*>(this)->find(key));
 }
 
-template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
-typename UnorderedMap<Key, Value, Hash, Equal, Alloc>::iterator
-UnorderedMap<Key, Value, Hash, Equal, Alloc>::find(
-    Key&& key, size_t key_hash) noexcept {
-  for (auto it = hash_table_[key_hash].first; it != hash_table_[key_hash].second; ++it) {
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+typename UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::iterator
+UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::find(
+    Key&& key, bucket_type& bucket) noexcept {
+  for (auto it = bucket; it != end(); ++it) {
     if (key_equal_(it->first, std::move(key))) {
       return it;
     }
+    if (!in_bucket(std::next(it), bucket)) {
+      break;
+    }
   }
   return end();
 }
 
-template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
-typename UnorderedMap<Key, Value, Hash, Equal, Alloc>::iterator
-UnorderedMap<Key, Value, Hash, Equal, Alloc>::find(Key&& key) noexcept {
-  return find(std::move(key), get_hash(key));
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+typename UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::iterator
+UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::find(Key&& key) noexcept {
+  if (is_small()) {
+    return find_small(key);
+  }
+  size_t hash = hasher_(key);
+  if (!bloom_.empty() && !bloom_may_contain(hash)) {
+    return end();
+  }
+  auto& bucket = get_bucket_by_hash(hash);
+  return find(std::move(key), bucket);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+typename UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::const_iterator
+UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::find(Key&& key) const noexcept {
+  return static_cast<const_iterator>(const_cast<UnorderedMap*>(this)->find(std::move(key)));
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+bool UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::contains(const Key& key) const noexcept {
+  return find(key) != end();
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+size_t UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::count(const Key& key) const noexcept {
+  return contains(key) ? 1 : 0;
 }
 
-template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
-typename UnorderedMap<Key, Value, Hash, Equal, Alloc>::const_iterator
-UnorderedMap<Key, Value, Hash, Equal, Alloc>::find(Key&& key) const noexcept {
-  return static_cast<const_iterator>(find(std::move(key), get_hash(key)));
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+template<typename InputIterator, typename Function>
+void UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::find_each(
+    InputIterator left_bound, InputIterator right_bound, Function&& function) {
+  if (is_small()) {
+    for (; left_bound != right_bound; ++left_bound) {
+      function(find_small(*left_bound));
+    }
+    return;
+  }
+  const Key* keys[PREFETCH_WINDOW_];
+  bucket_type* buckets[PREFETCH_WINDOW_];
+  size_t count = 0;
+  for (size_t step = 0;; ++step) {
+    if (left_bound != right_bound) {
+      // Keys rejected by the Bloom filter get no bucket and skip the prefetches.
+      size_t hash = hasher_(*left_bound);
+      keys[count % PREFETCH_WINDOW_] = &*left_bound;
+      if (bloom_.empty() || bloom_may_contain(hash)) {
+        buckets[count % PREFETCH_WINDOW_] = &get_bucket_by_hash(hash);
+        __builtin_prefetch(buckets[count % PREFETCH_WINDOW_]);
+      } else {
+        buckets[count % PREFETCH_WINDOW_] = nullptr;
+      }
+      ++left_bound;
+      ++count;
+    } else if (step >= count + 3 * PREFETCH_DISTANCE_) {
+      break;
+    }
+    if (step >= PREFETCH_DISTANCE_ && step - PREFETCH_DISTANCE_ < count) {
+      auto* bucket = buckets[(step - PREFETCH_DISTANCE_) % PREFETCH_WINDOW_];
+      if (bucket != nullptr && *bucket != end()) {
+        __builtin_prefetch(bucket->get_node());
+      }
+    }
+    if (step >= 2 * PREFETCH_DISTANCE_ && step - 2 * PREFETCH_DISTANCE_ < count) {
+      auto* bucket = buckets[(step - 2 * PREFETCH_DISTANCE_) % PREFETCH_WINDOW_];
+      if (bucket != nullptr && *bucket != end()) {
+        __builtin_prefetch(&**bucket);
+      }
+    }
+    if (step >= 3 * PREFETCH_DISTANCE_ && step - 3 * PREFETCH_DISTANCE_ < count) {
+      size_t i = (step - 3 * PREFETCH_DISTANCE_) % PREFETCH_WINDOW_;
+      function(buckets[i] == nullptr ? end() : find(*keys[i], *buckets[i]));
+    }
+  }
 }
 
-template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
-Value& UnorderedMap<Key, Value, Hash, Equal, Alloc>::operator[](const Key& key) noexcept {
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+template<typename InputIterator, typename OutputIterator>
+void UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::find_batch(
+    InputIterator left_bound, InputIterator right_bound, OutputIterator out) {
+  find_each(left_bound, right_bound, [&out](iterator it) {
+    *out++ = it;
+  });
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+template<typename InputIterator, typename OutputIterator>
+void UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::contains_batch(
+    InputIterator left_bound, InputIterator right_bound, OutputIterator out) const {
+  auto* self = const_cast<UnorderedMap*>(this);
+  self->find_each(left_bound, right_bound, [self, &out](iterator it) {
+    *out++ = it != self->end();
+  });
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+Value& UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::operator[](const Key& key) noexcept {
   auto pos = find(key);
   if (pos == end()) {
     pos = insert({key, Value()}).first;
@@ -813,8 +1546,8 @@ Value& UnorderedMap<Key, Value, Hash, Equal, Alloc>::operator[](const Key& key)
   return pos->second;
 }
 
-template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
-Value& UnorderedMap<Key, Value, Hash, Equal, Alloc>::at(const Key& key) {
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+Value& UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::at(const Key& key) {
   auto pos = find(key);
   if (pos == end()) {
     throw std::range_error("key does not exist");
@@ -823,13 +1556,13 @@ Value& UnorderedMap<Key, Value, Hash, Equal, Alloc>::at(const Key& key) {
   }
 }
 
-template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
-const Value& UnorderedMap<Key, Value, Hash, Equal, Alloc>::at(const Key& key) const {
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+const Value& UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::at(const Key& key) const {
   return at(key);
 }
 
-template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
-Value& UnorderedMap<Key, Value, Hash, Equal, Alloc>::at(Key&& key) {
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+Value& UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::at(Key&& key) {
   auto pos = find(std::move(key));
   if (pos == end()) {
     throw std::range_error("key does not exist");
@@ -838,19 +1571,22 @@ Value& UnorderedMap<Key, Value, Hash, Equal, Alloc>::at(Key&& key) {
   }
 }
 
-template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
-const Value& UnorderedMap<Key, Value, Hash, Equal, Alloc>::at(Key&& key) const {
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+const Value& UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::at(Key&& key) const {
   return at(std::move(key));
 }
 
-template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
-size_t UnorderedMap<Key, Value, Hash, Equal, Alloc>::size() const noexcept {
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+size_t UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::size() const noexcept {
   return list_.size();
 }
 
-template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
-void UnorderedMap<Key, Value, Hash, Equal, Alloc>::reserve(size_t count) {
-  size_t new_hash_table_size = hash_table_.size();
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+void UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::reserve(size_t count) {
+  if (is_small() && count <= SMALL_SIZE_) {
+    return;
+  }
+  size_t new_hash_table_size = std::max(hash_table_.size(), size_t(DEFAULT_TABLE_SIZE_));
   while (load_factor(count, new_hash_table_size) > max_load_factor()) {
     new_hash_table_size *= 2;
   }
@@ -859,10 +1595,10 @@ void UnorderedMap<Key, Value, Hash, Equal, Alloc>::reserve(size_t count) {
   }
 }
 
-template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
 template<typename... Args>
-std::pair<typename UnorderedMap<Key, Value, Hash, Equal, Alloc>::iterator, bool>
-UnorderedMap<Key, Value, Hash, Equal, Alloc>::emplace(Args&& ... args) {
+std::pair<typename UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::iterator, bool>
+UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::emplace(Args&& ... args) {
   node_type* ptr = AllocTraits::allocate(allocator_, 1);
   try {
     AllocTraits::construct(allocator_, ptr, std::forward<Args>(args)...);
@@ -871,54 +1607,38 @@ UnorderedMap<Key, Value, Hash, Equal, Alloc>::emplace(Args&& ... args) {
     throw;
   }
   const Key& key = ptr->first;
-  size_t hash = get_hash(key);
+  migrate(migration_step());
   iterator pos = find(key);
-  std::pair<iterator, bool> ans(pos, false);
-  if (pos == end()) {
-    if (load_factor(size() + 1, hash_table_.size()) > max_load_factor_) {
-      try {
-        rehash(2 * hash_table_.size());
-      } catch (...) {
-        AllocTraits::destroy(allocator_, ptr);
-        AllocTraits::deallocate(allocator_, ptr, 1);
-      }
-    }
-    auto& bucket_begin = hash_table_[hash].first, bucket_end = hash_table_[hash].second;
-    try {
-      if (bucket_begin == bucket_end) {
-        list_.push_front(ptr);
-        bucket_begin = begin(), bucket_end = begin() + 1;
-        ans = {bucket_begin, true};
-      } else {
-        list_.emplace(bucket_end, ptr);
-        ans = {bucket_end++, true};
-      }
-    } catch (...) {
-      AllocTraits::destroy(allocator_, ptr);
-      AllocTraits::deallocate(allocator_, ptr, 1);
-    }
-  } else {
+  if (pos != end()) {
+    AllocTraits::destroy(allocator_, ptr);
+    AllocTraits::deallocate(allocator_, ptr, 1);
+    return {pos, false};
+  }
+  try {
+    prepare_insert();
+    return {attach(list_.make_node(ptr)), true};
+  } catch (...) {
     AllocTraits::destroy(allocator_, ptr);
     AllocTraits::deallocate(allocator_, ptr, 1);
+    throw;
   }
-  return ans;
 }
 
-template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
-std::pair<typename UnorderedMap<Key, Value, Hash, Equal, Alloc>::iterator, bool>
-UnorderedMap<Key, Value, Hash, Equal, Alloc>::insert(const node_type& kv) {
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+std::pair<typename UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::iterator, bool>
+UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::insert(const node_type& kv) {
   return emplace(kv);
 }
 
-template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
-std::pair<typename UnorderedMap<Key, Value, Hash, Equal, Alloc>::iterator, bool>
-UnorderedMap<Key, Value, Hash, Equal, Alloc>::insert(node_type&& kv) {
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+std::pair<typename UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::iterator, bool>
+UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::insert(node_type&& kv) {
   return emplace(std::move(kv));
 }
 
-template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
 template<typename InputIterator>
-void UnorderedMap<Key, Value, Hash, Equal, Alloc>::insert(
+void UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::insert(
     const InputIterator& left_bound, const InputIterator& right_bound) {
   reserve(size() + std::distance(left_bound, right_bound));
   for (auto it = left_bound; it != right_bound; ++it) {
@@ -926,22 +1646,291 @@ void UnorderedMap<Key, Value, Hash, Equal, Alloc>::insert(
   }
 }
 
-template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
-void UnorderedMap<Key, Value, Hash, Equal, Alloc>::erase(const iterator& it) noexcept {
-  size_t hash = get_hash(it->first);
-  if (hash_table_[hash].first + 1 == hash_table_[hash].second) {
-    hash_table_[hash] = {end(), end()};
-  } else if (it + 1 == hash_table_[hash].second) {
-    --hash_table_[hash].second;
-  } else if (it == hash_table_[hash].first) {
-    ++hash_table_[hash].first;
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+template<typename RandomAccessIterator>
+void UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::parallel_insert(
+    RandomAccessIterator left_bound, RandomAccessIterator right_bound, size_t threads) {
+  size_t count = std::distance(left_bound, right_bound);
+  if (threads <= 1 || count < threads || size() + count <= SMALL_SIZE_) {
+    insert(left_bound, right_bound);
+    return;
+  }
+  migrate(old_hash_table_.size());
+  reserve(size() + count);
+  size_t bucket_count = hash_table_.size();
+  threads = std::min(threads, bucket_count);
+  auto partition_of_bucket = [threads, bucket_count](size_t bucket) {
+    return bucket * threads / bucket_count;
+  };
+  auto partition_begin = [threads, bucket_count](size_t partition) {
+    return (partition * bucket_count + threads - 1) / threads;
+  };
+
+  // Hash every input slice and count its keys per partition.
+  std::vector<size_t> buckets(count);
+  std::vector<size_t> hashes(CACHE_HASH_ ? count : 0);
+  std::vector<size_t> counts(threads * threads, 0);
+  run_parallel(threads, [&](size_t slice) {
+    for (size_t i = count * slice / threads; i < count * (slice + 1) / threads; ++i) {
+      size_t hash = hasher_(left_bound[i].first);
+      if constexpr (CACHE_HASH_) {
+        hashes[i] = hash;
+      }
+      buckets[i] = bucket_policy_(hash, bucket_count);
+      ++counts[slice * threads + partition_of_bucket(buckets[i])];
+    }
+  });
+
+  // Group input indices by partition, keeping input order.
+  std::vector<size_t> starts(threads + 1, 0);
+  for (size_t partition = 0, total = 0; partition < threads; ++partition) {
+    starts[partition] = total;
+    for (size_t slice = 0; slice < threads; ++slice) {
+      size_t slice_count = counts[slice * threads + partition];
+      counts[slice * threads + partition] = total;
+      total += slice_count;
+    }
+    starts[partition + 1] = total;
+  }
+  std::vector<size_t> order(count);
+  run_parallel(threads, [&](size_t slice) {
+    for (size_t i = count * slice / threads; i < count * (slice + 1) / threads; ++i) {
+      order[counts[slice * threads + partition_of_bucket(buckets[i])]++] = i;
+    }
+  });
+
+  // Everything a partition needs is allocated up front: once relinking has
+  // started every partition must finish, or nodes would be lost.
+  std::vector<std::vector<size_t>> bucket_starts(threads);
+  std::vector<std::vector<size_t>> members(threads);
+  for (size_t partition = 0; partition < threads; ++partition) {
+    bucket_starts[partition].assign(partition_begin(partition + 1) - partition_begin(partition) + 1, 0);
+    members[partition].resize(starts[partition + 1] - starts[partition]);
+  }
+  std::vector<iterator> firsts(threads, end());
+  std::vector<iterator> lasts(threads, end());
+  std::vector<size_t> sizes(threads, 0);
+  std::vector<std::exception_ptr> errors(threads);
+
+  // Each thread rewrites the links of its own nodes only, existing ones
+  // first, then new ones, bucket after bucket into one private chain.
+  run_parallel(threads, [&](size_t partition) {
+    size_t first_bucket = partition_begin(partition);
+    auto& offsets = bucket_starts[partition];
+    auto& local = members[partition];
+    for (size_t k = starts[partition]; k < starts[partition + 1]; ++k) {
+      ++offsets[buckets[order[k]] - first_bucket + 1];
+    }
+    for (size_t i = 1; i < offsets.size(); ++i) {
+      offsets[i] += offsets[i - 1];
+    }
+    for (size_t k = starts[partition]; k < starts[partition + 1]; ++k) {
+      local[offsets[buckets[order[k]] - first_bucket]++] = order[k];
+    }
+
+    iterator tail = end();
+    iterator head = end();
+    auto append = [&](iterator node) {
+      if (tail == end()) {
+        firsts[partition] = node;
+      } else {
+        List<node_type, Alloc, CACHE_HASH_>::chain(tail, node);
+      }
+      tail = node;
+      if (head == end()) {
+        head = node;
+      }
+      ++sizes[partition];
+    };
+    // After the placement pass offsets[i] is where bucket i's keys end.
+    for (size_t i = 0; i + 1 < offsets.size(); ++i) {
+      auto& bucket = hash_table_[first_bucket + i];
+      head = end();
+      for (auto it = bucket; it != end();) {
+        append(it);
+        auto next = std::next(it);
+        if (!in_bucket(next, bucket)) {
+          break;
+        }
+        it = next;
+      }
+      for (size_t k = i == 0 ? 0 : offsets[i - 1]; k < offsets[i] && !errors[partition]; ++k) {
+        const auto& kv = left_bound[local[k]];
+        bool duplicate = false;
+        for (auto it = head; it != end() && !duplicate; it = it == tail ? end() : std::next(it)) {
+          duplicate = key_equal_(kv.first, it->first);
+        }
+        if (duplicate) {
+          continue;
+        }
+        node_type* ptr = nullptr;
+        try {
+          ptr = AllocTraits::allocate(allocator_, 1);
+          AllocTraits::construct(allocator_, ptr, kv);
+        } catch (...) {
+          if (ptr != nullptr) {
+            AllocTraits::deallocate(allocator_, ptr, 1);
+          }
+          errors[partition] = std::current_exception();
+          break;
+        }
+        try {
+          iterator node = list_.make_node(ptr);
+          if constexpr (CACHE_HASH_) {
+            cache_hash(node, hashes[local[k]]);
+          }
+          append(node);
+        } catch (...) {
+          AllocTraits::destroy(allocator_, ptr);
+          AllocTraits::deallocate(allocator_, ptr, 1);
+          errors[partition] = std::current_exception();
+        }
+      }
+      bucket = head;
+    }
+    lasts[partition] = tail;
+  });
+
+  iterator first = end();
+  iterator last = end();
+  size_t total = 0;
+  for (size_t partition = 0; partition < threads; ++partition) {
+    if (sizes[partition] == 0) {
+      continue;
+    }
+    if (total == 0) {
+      first = firsts[partition];
+    } else {
+      List<node_type, Alloc, CACHE_HASH_>::chain(last, firsts[partition]);
+    }
+    last = lasts[partition];
+    total += sizes[partition];
+  }
+  list_.assign_chain(first, last, total);
+  // The partitions did not touch the filter; one pass adds the new keys.
+  bloom_refill();
+  for (auto& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+template<typename Function>
+void UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::parallel_for_each(
+    Function&& function, size_t threads) {
+  if (is_small()) {
+    for (auto it = begin(); it != end();) {
+      auto next = std::next(it);
+      function(*it);
+      it = next;
+    }
+    return;
+  }
+  // Buckets not yet migrated by an incremental rehash follow the new table.
+  size_t bucket_count = hash_table_.size() + old_hash_table_.size() - migrated_buckets_;
+  threads = std::max(size_t(1), std::min(threads, bucket_count));
+  run_parallel(threads, [&](size_t part) {
+    for (size_t i = bucket_count * part / threads; i < bucket_count * (part + 1) / threads; ++i) {
+      auto& bucket = i < hash_table_.size() ? hash_table_[i] :
+                     old_hash_table_[migrated_buckets_ + i - hash_table_.size()];
+      for (auto it = bucket; it != end();) {
+        auto next = std::next(it);
+        function(*it);
+        if (!in_bucket(next, bucket)) {
+          break;
+        }
+        it = next;
+      }
+    }
+  });
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+template<typename Function>
+void UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::parallel_for_each(
+    Function&& function, size_t threads) const {
+  const_cast<UnorderedMap*>(this)->parallel_for_each([&function](const node_type& kv) {
+    function(kv);
+  }, threads);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+void UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::detach(
+    bucket_type& bucket, const iterator& it) noexcept {
+  if (it == bucket) {
+    auto next = std::next(it);
+    bucket = in_bucket(next, bucket) ? next : end();
+  }
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+void UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::detach(const iterator& it) noexcept {
+  if (!is_small()) {
+    detach(get_bucket_by_hash(node_hash(it)), it);
+  }
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+void UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::prepare_insert() {
+  if (is_small()) {
+    if (size() >= SMALL_SIZE_) {
+      rehash(DEFAULT_TABLE_SIZE_);
+    }
+    return;
+  }
+  if (old_hash_table_.empty() && load_factor(size() + 1, hash_table_.size()) < min_load_factor_) {
+    shrink();
+  }
+  if (load_factor(size() + 1, hash_table_.size()) > max_load_factor_) {
+    grow();
+  }
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+typename UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::iterator
+UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::attach(iterator node) noexcept {
+  if (is_small()) {
+    return list_.link(begin(), node);
+  }
+  size_t hash = hasher_(node->first);
+  cache_hash(node, hash);
+  auto& bucket = get_bucket_by_hash(hash);
+  bucket = list_.link(bucket == end() ? begin() : bucket, node);
+  bloom_add(hash);
+  return bucket;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+void UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::erase(const iterator& it) noexcept {
+  detach(it);
+  list_.erase(it);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+size_t UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::erase(const Key& key) noexcept {
+  if (is_small()) {
+    auto it = find_small(key);
+    if (it == end()) {
+      return 0;
+    }
+    list_.erase(it);
+    return 1;
   }
+  auto& bucket = get_bucket(key);
+  auto it = find(key, bucket);
+  if (it == end()) {
+    return 0;
+  }
+  detach(bucket, it);
   list_.erase(it);
+  return 1;
 }
 
-template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
 template<typename InputIterator>
-void UnorderedMap<Key, Value, Hash, Equal, Alloc>::erase(
+void UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::erase(
     InputIterator left_bound, InputIterator right_bound) noexcept {
   auto it = left_bound;
   while (left_bound != right_bound) {
@@ -951,63 +1940,292 @@ void UnorderedMap<Key, Value, Hash, Equal, Alloc>::erase(
   }
 }
 
-template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
-typename UnorderedMap<Key, Value, Hash, Equal, Alloc>::iterator
-UnorderedMap<Key, Value, Hash, Equal, Alloc>::begin() noexcept {
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+typename UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::node_handle
+UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::extract(const iterator& it) noexcept {
+  detach(it);
+  return node_handle(list_.unlink(it), allocator_);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+typename UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::node_handle
+UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::extract(const Key& key) noexcept {
+  auto it = find(key);
+  if (it == end()) {
+    return node_handle();
+  }
+  detach(it);
+  return node_handle(list_.unlink(it), allocator_);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+typename UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::insert_return_type
+UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::insert(node_handle&& handle) {
+  if (handle.empty()) {
+    return {end(), false, node_handle()};
+  }
+  if (!(*handle.allocator_ == allocator_)) {
+    throw std::invalid_argument("node handle allocator differs from the map allocator");
+  }
+  migrate(migration_step());
+  iterator pos = find(handle.key());
+  if (pos != end()) {
+    return {pos, false, std::move(handle)};
+  }
+  prepare_insert();
+  pos = attach(handle.node_);
+  handle.node_ = iterator(nullptr);
+  return {pos, true, node_handle()};
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+void UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::merge(UnorderedMap& source) {
+  if (&source == this) {
+    return;
+  }
+  if (!(source.allocator_ == allocator_)) {
+    throw std::invalid_argument("merged map allocator differs from the map allocator");
+  }
+  // Extracting must not reorder the source while it is being walked.
+  source.migrate(source.old_hash_table_.size());
+  for (auto it = source.begin(); it != source.end();) {
+    auto next = std::next(it);
+    migrate(migration_step());
+    if (find(it->first) == end()) {
+      prepare_insert();
+      source.detach(it);
+      attach(source.list_.unlink(it));
+    }
+    it = next;
+  }
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::node_handle::node_handle(
+    iterator node, const Alloc& alloc) noexcept : node_(node), allocator_(alloc) {}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::node_handle::node_handle(
+    node_handle&& other) noexcept : node_(other.node_), allocator_(std::move(other.allocator_)) {
+  other.node_ = iterator(nullptr);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+typename UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::node_handle&
+UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::node_handle::operator=(node_handle&& other) noexcept {
+  std::swap(node_, other.node_);
+  std::swap(allocator_, other.allocator_);
+  return *this;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::node_handle::~node_handle() noexcept {
+  if (!empty()) {
+    List<node_type, Alloc, CACHE_HASH_>::free_node(node_, *allocator_);
+  }
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+bool UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::node_handle::empty() const noexcept {
+  return node_.get_node() == nullptr;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::node_handle::operator bool() const noexcept {
+  return !empty();
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+const Key& UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::node_handle::key() const noexcept {
+  return node_->first;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+Value& UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::node_handle::mapped() const noexcept {
+  return node_->second;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+Alloc UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::node_handle::get_allocator() const {
+  return *allocator_;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+typename UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::iterator
+UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::begin() noexcept {
   return list_.begin();
 }
 
-template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
-typename UnorderedMap<Key, Value, Hash, Equal, Alloc>::const_iterator
-UnorderedMap<Key, Value, Hash, Equal, Alloc>::begin() const noexcept {
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+typename UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::const_iterator
+UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::begin() const noexcept {
   return list_.begin();
 }
 
-template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
-typename UnorderedMap<Key, Value, Hash, Equal, Alloc>::const_iterator
-UnorderedMap<Key, Value, Hash, Equal, Alloc>::cbegin() const noexcept {
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+typename UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::const_iterator
+UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::cbegin() const noexcept {
   return list_.cbegin();
 }
 
-template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
-typename UnorderedMap<Key, Value, Hash, Equal, Alloc>::iterator
-UnorderedMap<Key, Value, Hash, Equal, Alloc>::end() noexcept {
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+typename UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::iterator
+UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::end() noexcept {
   return list_.end();
 }
 
-template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
-typename UnorderedMap<Key, Value, Hash, Equal, Alloc>::const_iterator
-UnorderedMap<Key, Value, Hash, Equal, Alloc>::end() const noexcept {
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+typename UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::const_iterator
+UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::end() const noexcept {
   return list_.cend();
 }
 
-template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
-typename UnorderedMap<Key, Value, Hash, Equal, Alloc>::const_iterator
-UnorderedMap<Key, Value, Hash, Equal, Alloc>::cend() const noexcept {
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+typename UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::const_iterator
+UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::cend() const noexcept {
   return list_.cend();
 }
 
-template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
-size_t UnorderedMap<Key, Value, Hash, Equal, Alloc>::max_size() const noexcept {
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+size_t UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::max_size() const noexcept {
   return AllocTraits::max_size(allocator_);
 }
 
-template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
-float UnorderedMap<Key, Value, Hash, Equal, Alloc>::max_load_factor() const noexcept {
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+Hash UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::hash_function() const {
+  return hasher_;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+Equal UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::key_eq() const {
+  return key_equal_;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+float UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::max_load_factor() const noexcept {
   return max_load_factor_;
 }
 
-template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
-void UnorderedMap<Key, Value, Hash, Equal, Alloc>::max_load_factor(float value) {
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+void UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::max_load_factor(float value) {
   max_load_factor_ = value;
 }
 
-template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
-float UnorderedMap<Key, Value, Hash, Equal, Alloc>::load_factor() const noexcept {
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+float UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::min_load_factor() const noexcept {
+  return min_load_factor_;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+void UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::min_load_factor(float value) noexcept {
+  min_load_factor_ = value;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+void UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::shrink_to_fit() {
+  if (size() <= SMALL_SIZE_) {
+    migrate(old_hash_table_.size());
+    hash_table_type(allocator_).swap(hash_table_);
+    bloom_type(allocator_).swap(bloom_);
+    return;
+  }
+  rehash(0);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+size_t UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::rehash_step() const noexcept {
+  return rehash_step_;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+void UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::rehash_step(size_t bucket_count) noexcept {
+  rehash_step_ = bucket_count;
+  if (rehash_step_ == 0) {
+    migrate(old_hash_table_.size());
+  }
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+size_t UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::bloom_bits_per_key() const noexcept {
+  return bloom_bits_per_key_;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+void UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::bloom_bits_per_key(size_t bits) {
+  bloom_bits_per_key_ = bits;
+  bloom_type new_bloom = make_bloom(hash_table_.size());
+  bloom_.swap(new_bloom);
+  bloom_refill();
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+float UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::load_factor() const noexcept {
+  if (is_small()) {
+    return 0;
+  }
   return static_cast<float>(size()) / static_cast<float>(hash_table_.size());
 }
 
-template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
-float UnorderedMap<Key, Value, Hash, Equal, Alloc>::load_factor(size_t count, size_t bucket_count) const noexcept {
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+float UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::load_factor(size_t count, size_t bucket_count) const noexcept {
   return static_cast<float>(count) / static_cast<float>(bucket_count);
 }
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+size_t UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::bucket_count() const noexcept {
+  return hash_table_.size();
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+size_t UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::bucket_size(size_t index) const noexcept {
+  if (is_small()) {
+    return index == 0 ? size() : 0;
+  }
+  auto* self = const_cast<UnorderedMap*>(this);
+  return self->chain_length(self->hash_table_[index]);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+size_t UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::bucket(const Key& key) const noexcept {
+  if (is_small()) {
+    return 0;
+  }
+  return get_hash(key);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, typename Alloc, typename BucketPolicy>
+typename UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::Stats
+UnorderedMap<Key, Value, Hash, Equal, Alloc, BucketPolicy>::stats() const {
+  auto* self = const_cast<UnorderedMap*>(this);
+  Stats result;
+  result.size = size();
+  result.rehash_count = rehash_count_;
+  result.rehash_time = rehash_time_;
+  result.bloom_filter_bytes = (bloom_.size() + old_bloom_.size()) * sizeof(BloomBlock);
+  auto add_bucket = [self, &result](const bucket_type& bucket) {
+    size_t length = self->chain_length(bucket);
+    if (length >= result.occupancy.size()) {
+      result.occupancy.resize(length + 1);
+    }
+    ++result.occupancy[length];
+    ++result.bucket_count;
+    result.max_chain_length = std::max(result.max_chain_length, length);
+  };
+  for (const auto& bucket : hash_table_) {
+    add_bucket(bucket);
+  }
+  for (size_t i = migrated_buckets_; i < old_hash_table_.size(); ++i) {
+    add_bucket(old_hash_table_[i]);
+  }
+  result.empty_buckets = result.occupancy.empty() ? 0 : result.occupancy[0];
+  if (result.bucket_count > 0) {
+    result.empty_bucket_ratio = static_cast<float>(result.empty_buckets) / static_cast<float>(result.bucket_count);
+  }
+  if (result.bucket_count > result.empty_buckets) {
+    result.mean_chain_length = static_cast<float>(result.size) /
+        static_cast<float>(result.bucket_count - result.empty_buckets);
+  }
+  return result;
+}
+
+#endif //UNORDERED_MAP__UNORDERED_MAP_H_
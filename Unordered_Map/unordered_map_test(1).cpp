@@ -4,7 +4,12 @@
 #include <vector>
 #include <string>
 #include <iterator>
+#include <atomic>
 #include <cassert>
+#include <mutex>
+#include <numeric>
+#include <stdexcept>
+#include <tuple>
 
 #include <iostream>
 
@@ -396,6 +401,585 @@ void TestCustomAlloc() {
     }    
 }
 
+template<typename BucketPolicy>
+void TestBucketPolicy() {
+    UnorderedMap<int, int, std::hash<int>, std::equal_to<int>,
+        std::allocator<std::pair<const int, int>>, BucketPolicy> m(100, std::allocator<std::pair<const int, int>>());
+
+    for (int i = 0; i < 100'000; ++i) {
+        m.emplace(i * 64, i);
+    }
+    assert(m.size() == 100'000);
+    for (int i = 0; i < 100'000; ++i) {
+        assert(m.at(i * 64) == i);
+        assert(m.find(i * 64 + 1) == m.end());
+    }
+    for (int i = 0; i < 100'000; i += 2) {
+        m.erase(m.find(i * 64));
+    }
+    assert(m.size() == 50'000);
+    for (int i = 0; i < 100'000; ++i) {
+        assert((m.find(i * 64) == m.end()) == (i % 2 == 0));
+    }
+}
+
+void TestBucketPolicies() {
+    TestBucketPolicy<ModuloBucketPolicy>();
+    TestBucketPolicy<PowerOfTwoBucketPolicy>();
+    TestBucketPolicy<FastRangeBucketPolicy>();
+}
+
+void TestIncrementalRehash() {
+    UnorderedMap<int, int> m;
+    m.rehash_step(2);
+    assert(m.rehash_step() == 2);
+
+    auto first = m.emplace(-1, -1).first;
+    for (int i = 0; i < 100'000; ++i) {
+        m.emplace(i, i);
+        if (i % 7 == 0 && i / 2 % 3 != 0) {
+            assert(m.at(i / 2) == i / 2);
+            assert(m.find(i + 1) == m.end());
+        }
+        if (i % 3 == 0) {
+            m.erase(m.find(i));
+        }
+    }
+    assert(first->first == -1);
+    assert(m.size() == 100'000 - 33'334 + 1);
+
+    size_t count = 0;
+    for (auto it = m.begin(); it != m.end(); ++it) {
+        assert(it->first % 3 != 0 || it->first == -1);
+        ++count;
+    }
+    assert(count == m.size());
+
+    m.rehash_step(0);
+    for (int i = 0; i < 100'000; ++i) {
+        assert((m.find(i) == m.end()) == (i % 3 == 0));
+    }
+
+    // Erasing in the middle of a migration leaves the list order alone.
+    UnorderedMap<int, int> walked;
+    walked.rehash_step(1);
+    int key = 0;
+    for (size_t buckets = walked.bucket_count(); walked.bucket_count() == buckets || buckets < 64; ++key) {
+        buckets = walked.bucket_count();
+        walked.emplace(key, key);
+    }
+    for (auto it = walked.begin(); it != walked.end();) {
+        if (it->first % 2 == 0) {
+            auto next = std::next(it);
+            walked.erase(it);
+            it = next;
+        } else {
+            ++it;
+        }
+    }
+    assert(walked.size() == static_cast<size_t>(key / 2));
+    for (const auto& kv : walked) {
+        assert(kv.first % 2 == 1);
+    }
+    for (size_t buckets = walked.bucket_count(); walked.bucket_count() == buckets; ++key) {
+        walked.emplace(key, key);
+    }
+    walked.erase(walked.begin(), walked.end());
+    assert(walked.size() == 0 && walked.begin() == walked.end());
+}
+
+size_t hash_calls = 0;
+
+struct CountingHash {
+    size_t operator()(int key) const {
+        ++hash_calls;
+        return std::hash<int>()(key);
+    }
+};
+
+struct CountingStringHash {
+    size_t operator()(const std::string& key) const {
+        ++hash_calls;
+        return std::hash<std::string>()(key);
+    }
+};
+
+// String nodes keep the hash of their key: walking a chain, rehashing and
+// copying hash no stored key again.
+void TestCachedHashes() {
+    UnorderedMap<std::string, int, CountingStringHash> m;
+    m.max_load_factor(4);
+    for (int i = 0; i < 10'000; ++i) {
+        m.emplace(std::to_string(i), i);
+    }
+    hash_calls = 0;
+    for (int i = 0; i < 20'000; ++i) {
+        assert(m.contains(std::to_string(i)) == (i < 10'000));
+    }
+    assert(hash_calls == 20'000);
+
+    hash_calls = 0;
+    m.rehash(m.bucket_count() * 4);
+    UnorderedMap<std::string, int, CountingStringHash> copy = m;
+    assert(hash_calls == 0);
+    assert(copy.erase("42") == 1 && copy.at("43") == 43 && !copy.contains("42"));
+    assert(hash_calls == 3);
+}
+
+// Even a step of one bucket finishes each migration before the next growth,
+// so no insert ever hashes the whole map.
+void TestMigrationStep() {
+    UnorderedMap<int, int, CountingHash> m;
+    m.rehash_step(1);
+    size_t max_calls = 0;
+    for (int i = 0; i < 200'000; ++i) {
+        hash_calls = 0;
+        m.emplace(i, i);
+        max_calls = std::max(max_calls, hash_calls);
+    }
+    assert(max_calls < 64);
+    assert(m.size() == 200'000 && m.at(123'456) == 123'456);
+}
+
+void TestRehashKeepsNodes() {
+    UnorderedMap<std::string, int> m;
+    auto it = m.emplace("first", 1).first;
+    const std::string* key = &it->first;
+    for (int i = 0; i < 10'000; ++i) {
+        m.emplace(std::to_string(i), i);
+    }
+    m.reserve(1'000'000);
+    assert(&m.find("first")->first == key);
+    assert(it->second == 1);
+    for (int i = 0; i < 10'000; ++i) {
+        assert(m.at(std::to_string(i)) == i);
+    }
+    assert(static_cast<size_t>(std::distance(m.begin(), m.end())) == m.size());
+}
+
+void TestBatchLookup() {
+    UnorderedMap<std::string, int> m;
+    std::vector<std::string> keys;
+    for (int i = 0; i < 1000; ++i) {
+        keys.push_back(std::to_string(i));
+        if (i % 3 != 0) {
+            m.emplace(keys.back(), i);
+        }
+    }
+
+    std::vector<UnorderedMap<std::string, int>::iterator> found;
+    m.find_batch(keys.begin(), keys.end(), std::back_inserter(found));
+    assert(found.size() == keys.size());
+
+    std::vector<bool> contained(keys.size());
+    const auto& cm = m;
+    cm.contains_batch(keys.begin(), keys.end(), contained.begin());
+
+    for (int i = 0; i < 1000; ++i) {
+        assert(found[i] == m.find(keys[i]));
+        assert(contained[i] == (i % 3 != 0));
+        assert(i % 3 == 0 || found[i]->second == i);
+    }
+}
+
+void TestShrink() {
+    UnorderedMap<int, int> m;
+    for (int i = 0; i < 100'000; ++i) {
+        m.emplace(i, i);
+    }
+    for (int i = 0; i < 100'000; ++i) {
+        if (i % 20 != 0) {
+            m.erase(m.find(i));
+        }
+    }
+    assert(m.load_factor() < 0.05);
+
+    m.shrink_to_fit();
+    assert(m.load_factor() > 0.5 && m.load_factor() <= m.max_load_factor());
+    m.rehash(1 << 16);
+    assert(m.load_factor() == 5'000.0f / (1 << 16));
+
+    m.min_load_factor(0.1);
+    for (int i = 0; i < 100'000; i += 40) {
+        m.erase(m.find(i));
+    }
+    auto it = m.emplace(-1, -1).first;
+    assert(m.load_factor() > 0.1 && m.load_factor() <= m.max_load_factor() / 2);
+    for (int i = 0; i < 10; ++i) {
+        m.emplace(i, i);
+        m.erase(m.find(i));
+    }
+    assert(it->first == -1 && m.size() == 2'501);
+    assert(m.load_factor() > 0.1);
+}
+
+struct ConstantHash {
+    size_t operator()(int) const {
+        return 0;
+    }
+};
+
+template<typename Map>
+void CheckStats(const Map& m) {
+    auto stats = m.stats();
+    assert(stats.size == m.size());
+    size_t buckets = 0;
+    size_t nodes = 0;
+    for (size_t k = 0; k < stats.occupancy.size(); ++k) {
+        buckets += stats.occupancy[k];
+        nodes += k * stats.occupancy[k];
+    }
+    assert(buckets == stats.bucket_count && nodes == m.size());
+    assert(stats.occupancy.size() == stats.max_chain_length + 1);
+    assert(stats.empty_bucket_ratio * stats.bucket_count == stats.empty_buckets);
+}
+
+void TestStats() {
+    UnorderedMap<int, int> m;
+    for (int i = 0; i < 1000; ++i) {
+        m.emplace(i, i);
+    }
+    CheckStats(m);
+    size_t total = 0;
+    for (size_t i = 0; i < m.bucket_count(); ++i) {
+        total += m.bucket_size(i);
+    }
+    assert(total == m.size());
+    assert(m.bucket_size(m.bucket(42)) == 1);
+    assert(m.stats().rehash_count == 6 && m.stats().max_chain_length == 1);
+
+    m.rehash_step(1);
+    for (int i = 1000; i < 2000; ++i) {
+        m.emplace(i, i);
+    }
+    CheckStats(m);
+
+    UnorderedMap<int, int, ConstantHash> bad;
+    for (int i = 0; i < 100; ++i) {
+        bad.emplace(i, i);
+    }
+    CheckStats(bad);
+    auto stats = bad.stats();
+    assert(stats.max_chain_length == 100 && stats.mean_chain_length == 100);
+    assert(stats.empty_buckets == stats.bucket_count - 1);
+    assert(bad.bucket_size(bad.bucket(7)) == 100);
+}
+
+struct Pinned {
+    int value;
+
+    explicit Pinned(int value) : value(value) {}
+    Pinned(const Pinned&) = delete;
+    Pinned(Pinned&&) = delete;
+};
+
+void TestNodeHandles() {
+    using PinnedMap = UnorderedMap<int, Pinned>;
+    PinnedMap staging;
+    for (int i = 0; i < 100; ++i) {
+        staging.emplace(std::piecewise_construct, std::forward_as_tuple(i), std::forward_as_tuple(i * 10));
+    }
+    const Pinned* address = &staging.find(42)->second;
+
+    auto handle = staging.extract(42);
+    assert(handle && handle.key() == 42 && &handle.mapped() == address);
+    assert(staging.size() == 99 && staging.find(42) == staging.end());
+    assert(staging.extract(42).empty());
+
+    PinnedMap live;
+    auto result = live.insert(std::move(handle));
+    assert(result.inserted && handle.empty() && result.node.empty());
+    assert(&result.position->second == address && live.find(42) == result.position);
+
+    auto copy = staging.extract(staging.find(7));
+    live.emplace(std::piecewise_construct, std::forward_as_tuple(7), std::forward_as_tuple(-1));
+    result = live.insert(std::move(copy));
+    assert(!result.inserted && result.node && result.node.mapped().value == 70);
+    assert(result.position->second.value == -1);
+    assert(live.insert(PinnedMap::node_handle()).position == live.end());
+
+    live.merge(staging);
+    assert(live.size() == 100 && staging.size() == 0);
+    for (int i = 0; i < 100; ++i) {
+        assert(live.at(i).value == (i == 7 ? -1 : i * 10));
+    }
+
+    staging.emplace(std::piecewise_construct, std::forward_as_tuple(1), std::forward_as_tuple(0));
+    staging.emplace(std::piecewise_construct, std::forward_as_tuple(1000), std::forward_as_tuple(0));
+    live.merge(staging);
+    assert(live.size() == 101 && staging.size() == 1 && staging.find(1) != staging.end());
+}
+
+void TestKeyErase() {
+    UnorderedMap<std::string, int> m;
+    for (int i = 0; i < 1000; ++i) {
+        m.emplace(std::to_string(i), i);
+    }
+    m.rehash_step(4);
+    for (int i = 1000; i < 2000; ++i) {
+        m.emplace(std::to_string(i), i);
+        assert(m.erase(std::to_string(i - 1000)) == 1);
+        assert(m.erase(std::to_string(i - 1000)) == 0);
+    }
+    const auto& cm = m;
+    assert(cm.size() == 1000);
+    for (int i = 0; i < 2000; ++i) {
+        assert(cm.contains(std::to_string(i)) == (i >= 1000));
+        assert(cm.count(std::to_string(i)) == (i >= 1000 ? 1 : 0));
+    }
+}
+
+void TestParallel() {
+    UnorderedMap<int, int> m;
+    for (int i = 0; i < 30'000; i += 3) {
+        m.emplace(i, -i);
+    }
+    m.rehash_step(1);
+    for (int i = 30'000; i < 31'000; ++i) {
+        m.emplace(i, -i);
+    }
+
+    std::vector<std::pair<const int, int>> input;
+    for (int i = 0; i < 60'000; i += 2) {
+        input.emplace_back(i, i);
+    }
+    input.emplace_back(2, 2);
+    m.parallel_insert(input.begin(), input.end(), 4);
+
+    for (int i = 0; i < 60'000; ++i) {
+        auto it = m.find(i);
+        bool old = (i % 3 == 0 && i < 30'000) || (i >= 30'000 && i < 31'000);
+        assert((it != m.end()) == (old || i % 2 == 0));
+        assert(it == m.end() || it->second == (old ? -i : i));
+    }
+    size_t count = 0;
+    for (auto it = m.begin(); it != m.end(); ++it) {
+        ++count;
+    }
+    assert(count == m.size() && count == 10'000 + 500 + 30'000 - 5'000);
+    CheckStats(m);
+
+    std::atomic<long long> sum{0};
+    m.parallel_for_each([&sum](std::pair<const int, int>& kv) {
+        kv.second = 1;
+        sum += kv.first;
+    }, 3);
+    long long expected = 0;
+    for (auto it = m.begin(); it != m.end(); ++it) {
+        assert(it->second == 1);
+        expected += it->first;
+    }
+    assert(sum == expected);
+
+    const auto& cm = m;
+    size_t visited = 0;
+    std::mutex mutex;
+    cm.parallel_for_each([&](const std::pair<const int, int>&) {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++visited;
+    }, 8);
+    assert(visited == m.size());
+}
+
+void TestSmallMap() {
+    UnorderedMap<std::string, int> m;
+    assert(m.bucket_count() == 0 && m.load_factor() == 0);
+    assert(m.bucket("a") == 0 && m.bucket_size(0) == 0);
+    m.emplace("x", 0);
+    assert(m.bucket("x") == 0 && m.bucket("y") == 0 && m.bucket_size(0) == 1 && m.bucket_size(1) == 0);
+    m.erase("x");
+    for (int i = 0; i < 8; ++i) {
+        assert(m.emplace(std::to_string(i), i).second);
+        assert(!m.emplace(std::to_string(i), -1).second);
+    }
+    assert(m.bucket_count() == 0 && m.size() == 8);
+    assert(m.at("5") == 5 && m.count("8") == 0);
+    std::vector<std::string> keys = {"3", "9", "0"};
+    std::vector<bool> found;
+    m.contains_batch(keys.begin(), keys.end(), std::back_inserter(found));
+    assert((found == std::vector<bool>{true, false, true}));
+
+    auto handle = m.extract("7");
+    assert(m.erase("6") == 1 && m.erase("6") == 0 && m.size() == 6);
+    assert(m.insert(std::move(handle)).inserted && m.bucket_count() == 0);
+
+    for (int i = 8; i < 100; ++i) {
+        m.emplace(std::to_string(i), i);
+    }
+    assert(m.bucket_count() > 0);
+    CheckStats(m);
+    for (int i = 0; i < 100; ++i) {
+        assert(m.contains(std::to_string(i)) == (i != 6));
+    }
+
+    for (int i = 9; i < 100; ++i) {
+        m.erase(std::to_string(i));
+    }
+    m.shrink_to_fit();
+    assert(m.bucket_count() == 0 && m.size() == 8 && m.find("4")->second == 4);
+    int sum = 0;
+    m.parallel_for_each([&sum](std::pair<const std::string, int>& kv) {
+        sum += kv.second;
+    }, 4);
+    assert(sum == 36 - 6);
+
+    UnorderedMap<std::string, int> other;
+    other.merge(m);
+    assert(m.size() == 0 && other.size() == 8 && other.bucket_count() == 0);
+    other.emplace("a", 0);
+    assert(other.bucket_count() > 0 && other.at("8") == 8);
+}
+
+void TestBloomFilter() {
+    UnorderedMap<int, int> m;
+    m.bloom_bits_per_key(10);
+    assert(m.stats().bloom_filter_bytes == 0);
+    for (int i = 0; i < 20'000; i += 2) {
+        m.emplace(i, i);
+    }
+    size_t bytes = m.stats().bloom_filter_bytes;
+    assert(bytes > 0 && bytes % 64 == 0);
+    for (int i = 0; i < 20'000; ++i) {
+        assert(m.contains(i) == (i % 2 == 0));
+    }
+    std::vector<int> keys(1000);
+    std::iota(keys.begin(), keys.end(), 5000);
+    std::vector<bool> found;
+    m.contains_batch(keys.begin(), keys.end(), std::back_inserter(found));
+    for (size_t i = 0; i < keys.size(); ++i) {
+        assert(found[i] == (keys[i] % 2 == 0));
+    }
+
+    // Erased keys keep their bits until the next rehash but are still missed.
+    for (int i = 0; i < 20'000; i += 4) {
+        assert(m.erase(i) == 1);
+    }
+    m.rehash(0);
+    for (int i = 0; i < 20'000; ++i) {
+        assert(m.contains(i) == (i % 4 == 2));
+    }
+
+    UnorderedMap<int, int> incremental;
+    incremental.bloom_bits_per_key(8);
+    incremental.rehash_step(4);
+    std::vector<std::pair<const int, int>> input;
+    for (int i = 0; i < 5000; ++i) {
+        incremental.emplace(i, i);
+        input.emplace_back(i + 5000, i);
+    }
+    incremental.parallel_insert(input.begin(), input.end(), 4);
+    for (int i = 0; i < 12'000; ++i) {
+        assert(incremental.contains(i) == (i < 10'000));
+    }
+
+    UnorderedMap<int, int> moved = std::move(incremental);
+    assert(moved.bloom_bits_per_key() == 8 && moved.at(9999) == 4999 && !moved.contains(10'000));
+    moved.bloom_bits_per_key(0);
+    assert(moved.stats().bloom_filter_bytes == 0 && moved.contains(42));
+
+    // Growing starts an empty filter that fills as buckets migrate, so no
+    // insert hashes every key; until then lookups check both filters.
+    UnorderedMap<int, int, CountingHash> counted;
+    counted.bloom_bits_per_key(10);
+    counted.rehash_step(4);
+    size_t max_calls = 0;
+    for (int i = 0; i < 100'000; ++i) {
+        hash_calls = 0;
+        counted.emplace(i, i);
+        max_calls = std::max(max_calls, hash_calls);
+        if (i % 97 == 0) {
+            assert(counted.contains(i / 2) && counted.contains(i) && !counted.contains(-i - 1));
+        }
+    }
+    assert(max_calls < 64 && counted.stats().bloom_filter_bytes > 0);
+
+    UnorderedMap<std::string, int> small;
+    small.bloom_bits_per_key(10);
+    small.emplace("a", 1);
+    assert(small.stats().bloom_filter_bytes == 0 && small.contains("a") && !small.contains("b"));
+    for (int i = 0; i < 100; ++i) {
+        small.emplace(std::to_string(i), i);
+    }
+    assert(small.stats().bloom_filter_bytes > 0 && small.at("a") == 1 && small.at("99") == 99);
+}
+
+struct ThrowingCopy {
+    static inline int copies_left = 0;
+    int value;
+
+    explicit ThrowingCopy(int value) : value(value) {}
+    ThrowingCopy(const ThrowingCopy& other) : value(other.value) {
+        if (copies_left-- == 0) {
+            throw std::runtime_error("copy");
+        }
+    }
+};
+
+template<typename Map>
+void CheckSameLayout(const Map& a, const Map& b) {
+    assert(a.size() == b.size() && a.bucket_count() == b.bucket_count());
+    for (auto it = a.begin(), jt = b.begin(); it != a.end(); ++it, ++jt) {
+        assert(it->first == jt->first && it->second == jt->second);
+    }
+    for (size_t i = 0; i < a.bucket_count(); ++i) {
+        assert(a.bucket_size(i) == b.bucket_size(i));
+    }
+}
+
+void TestCopyStructure() {
+    UnorderedMap<int, int, std::hash<int>, std::equal_to<int>,
+                 std::allocator<std::pair<const int, int>>, FastRangeBucketPolicy> m;
+    m.max_load_factor(0.5);
+    m.bloom_bits_per_key(10);
+    m.rehash_step(3);
+    for (int i = 0; i < 10'000; ++i) {
+        m.emplace(i, -i);
+    }
+    // The copy is taken in the middle of an incremental rehash.
+    auto copy = m;
+    assert(copy.max_load_factor() == 0.5 && copy.bloom_bits_per_key() == 10 && copy.rehash_step() == 3);
+    assert(copy.stats().bloom_filter_bytes == m.stats().bloom_filter_bytes);
+    CheckSameLayout(m, copy);
+    CheckStats(copy);
+    for (int i = 0; i < 20'000; ++i) {
+        assert(copy.contains(i) == (i < 10'000));
+    }
+    for (int i = 10'000; i < 20'000; ++i) {
+        copy.emplace(i, -i);
+    }
+    assert(copy.size() == 20'000 && m.size() == 10'000 && copy.at(15'000) == -15'000);
+
+    m = copy;
+    CheckSameLayout(m, copy);
+    m = m;
+    assert(m.size() == 20'000 && m.at(19'999) == -19'999);
+
+    UnorderedMap<std::string, int> small;
+    small.emplace("a", 1);
+    small.emplace("b", 2);
+    auto small_copy = small;
+    assert(small_copy.size() == 2 && small_copy.at("b") == 2 && small_copy.begin()->first == small.begin()->first);
+    small_copy = UnorderedMap<std::string, int>();
+    small_copy = small;
+    assert(small_copy.at("a") == 1);
+
+    UnorderedMap<int, ThrowingCopy> throwing;
+    for (int i = 0; i < 100; ++i) {
+        throwing.emplace(i, i);
+    }
+    ThrowingCopy::copies_left = 50;
+    bool thrown = false;
+    try {
+        auto partial = throwing;
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    assert(thrown && throwing.size() == 100);
+    ThrowingCopy::copies_left = 1000;
+    auto full = throwing;
+    assert(full.size() == 100 && full.at(99).value == 99);
+}
+
 int main() {
     std::cerr << "Starting tests" << std::endl;
     SimpleTest();
@@ -410,5 +994,33 @@ int main() {
     std::cerr << "TestCustomHashAndCompare (5 of 6) passed" << std::endl;
     TestCustomAlloc();
     std::cerr << "TestCustomAlloc (6 of 6) passed" << std::endl;
+    TestBucketPolicies();
+    std::cerr << "TestBucketPolicies passed" << std::endl;
+    TestIncrementalRehash();
+    std::cerr << "TestIncrementalRehash passed" << std::endl;
+    TestMigrationStep();
+    std::cerr << "TestMigrationStep passed" << std::endl;
+    TestCachedHashes();
+    std::cerr << "TestCachedHashes passed" << std::endl;
+    TestRehashKeepsNodes();
+    std::cerr << "TestRehashKeepsNodes passed" << std::endl;
+    TestBatchLookup();
+    std::cerr << "TestBatchLookup passed" << std::endl;
+    TestShrink();
+    std::cerr << "TestShrink passed" << std::endl;
+    TestStats();
+    std::cerr << "TestStats passed" << std::endl;
+    TestNodeHandles();
+    std::cerr << "TestNodeHandles passed" << std::endl;
+    TestKeyErase();
+    std::cerr << "TestKeyErase passed" << std::endl;
+    TestParallel();
+    std::cerr << "TestParallel passed" << std::endl;
+    TestSmallMap();
+    std::cerr << "TestSmallMap passed" << std::endl;
+    TestBloomFilter();
+    std::cerr << "TestBloomFilter passed" << std::endl;
+    TestCopyStructure();
+    std::cerr << "TestCopyStructure passed" << std::endl;
     std::cout << 0;
 }